@@ -0,0 +1,204 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Loop checks when connecting and disconnecting a 500 source graph: the recursive upstream
+ * walk that connectors used before ConnectionIndex against the index.
+ *
+ * The sources form layers, each source reads up to fan in sources of the layer before. The
+ * graph is connected in random order, then connections are moved around and connections
+ * that would close a loop are tried. The upstream walk follows every path, so its cost grows
+ * with the fan in while the index only searches between the two ends.
+ *
+ * usage: connectbench [layers] [width] [moves] [fan in]
+ */
+#include "source.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace bipscript;
+
+/**
+ * Source that only records what it reads from.
+ */
+class BenchSource : public AbstractSource
+{
+public:
+    std::vector<BenchSource*> inputs;
+    /**
+     * The loop check used by connectors before ConnectionIndex: walk every path upstream.
+     */
+    bool connectsTo(AbstractSource *source) {
+        for(BenchSource *input : inputs) {
+            if(input == source || input->connectsTo(source)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    void removeInput(BenchSource *input) {
+        for(auto it = inputs.begin(); it != inputs.end(); it++) {
+            if(*it == input) {
+                inputs.erase(it);
+                return;
+            }
+        }
+    }
+    void doProcess(bool, jack_position_t &, jack_nframes_t, jack_nframes_t) {}
+    void reposition() {}
+};
+
+typedef std::pair<BenchSource*, BenchSource*> Edge; // from, to
+
+class Check
+{
+public:
+    virtual bool connect(BenchSource *from, BenchSource *to) = 0;
+    virtual void disconnect(BenchSource *from, BenchSource *to) = 0;
+};
+
+class WalkCheck : public Check
+{
+public:
+    bool connect(BenchSource *from, BenchSource *to) {
+        if(from == to || from->connectsTo(to)) {
+            return false;
+        }
+        to->inputs.push_back(from);
+        return true;
+    }
+    void disconnect(BenchSource *from, BenchSource *to) {
+        to->removeInput(from);
+    }
+};
+
+class IndexCheck : public Check
+{
+public:
+    bool connect(BenchSource *from, BenchSource *to) {
+        if(!ConnectionIndex::instance().connect(from, to)) {
+            return false;
+        }
+        to->inputs.push_back(from);
+        return true;
+    }
+    void disconnect(BenchSource *from, BenchSource *to) {
+        ConnectionIndex::instance().disconnect(from, to);
+        to->removeInput(from);
+    }
+};
+
+struct Result {
+    double build; // microseconds per connection
+    double moves; // microseconds per disconnect and connect
+    double loops; // microseconds per connection tried against the layers
+    int refused;
+};
+
+Result run(Check &check, int layers, int width, int moves, int fanIn, unsigned int seed)
+{
+    srand(seed);
+    std::vector<std::vector<BenchSource*>> graph(layers);
+    for(int l = 0; l < layers; l++) {
+        for(int w = 0; w < width; w++) {
+            graph[l].push_back(new BenchSource());
+        }
+    }
+    // up to fan in distinct inputs from the layer before
+    std::vector<Edge> edges;
+    for(int l = 1; l < layers; l++) {
+        for(BenchSource *to : graph[l]) {
+            int first = rand() % width;
+            for(int i = 0; i < fanIn && i < width; i++) {
+                edges.push_back(Edge(graph[l - 1][(first + i) % width], to));
+            }
+        }
+    }
+    for(size_t i = edges.size() - 1; i > 0; i--) {
+        std::swap(edges[i], edges[rand() % (i + 1)]);
+    }
+    Result result;
+
+    auto start = std::chrono::steady_clock::now();
+    for(Edge &edge : edges) {
+        if(!check.connect(edge.first, edge.second)) {
+            throw std::logic_error("forward connection refused");
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.build = std::chrono::duration<double, std::micro>(end - start).count() / edges.size();
+
+    // move connections to another source of the layer before
+    start = std::chrono::steady_clock::now();
+    for(int m = 0; m < moves; m++) {
+        Edge &edge = edges[rand() % edges.size()];
+        check.disconnect(edge.first, edge.second);
+        int layer = rand() % (layers - 1);
+        edge.first = graph[layer][rand() % width];
+        edge.second = graph[layer + 1][rand() % width];
+        check.connect(edge.first, edge.second);
+    }
+    end = std::chrono::steady_clock::now();
+    result.moves = std::chrono::duration<double, std::micro>(end - start).count() / moves;
+
+    // connections from deep sources back to the top, refused when a path leads down
+    int tries = 0;
+    result.refused = 0;
+    start = std::chrono::steady_clock::now();
+    for(int m = 0; m < moves; m++) {
+        BenchSource *from = graph[layers - 1 - rand() % 4][rand() % width];
+        BenchSource *to = graph[rand() % 4][rand() % width];
+        tries++;
+        if(check.connect(from, to)) {
+            check.disconnect(from, to);
+        } else {
+            result.refused++;
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    result.loops = std::chrono::duration<double, std::micro>(end - start).count() / tries;
+
+    for(auto &layer : graph) {
+        for(BenchSource *source : layer) {
+            delete source;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int layers = argc > 1 ? atoi(argv[1]) : 20;
+    int width = argc > 2 ? atoi(argv[2]) : 25;
+    int moves = argc > 3 ? atoi(argv[3]) : 2000;
+    int fanIn = argc > 4 ? atoi(argv[4]) : 2;
+
+    printf("%d sources in %d layers, fan in %d, %d moves\n", layers * width, layers, fanIn, moves);
+    printf("check   connect us  move us  loop check us  refused\n");
+    WalkCheck walk;
+    Result result = run(walk, layers, width, moves, fanIn, 1);
+    printf("walk    %10.2f  %7.2f  %13.2f  %7d\n", result.build, result.moves, result.loops, result.refused);
+    IndexCheck index;
+    result = run(index, layers, width, moves, fanIn, 1);
+    printf("index   %10.2f  %7.2f  %13.2f  %7d\n", result.build, result.moves, result.loops, result.refused);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Per period wall time of the graph executor against the number of process workers.
+ *
+ * Builds a wide graph of independent chains that all feed one sink, every node filtering a
+ * period of audio, and runs it serially and then with 1..N workers.
+ *
+ * usage: graphbench [chains] [depth] [periods] [max workers]
+ */
+#include "processgraph.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace bipscript;
+
+const jack_nframes_t PERIOD = 1024;
+
+/**
+ * Graph node that runs a one pole filter over its own buffer a number of times per period.
+ */
+class FilterNode : public Processor
+{
+    std::vector<Processor*> sources;
+    float buffer[PERIOD];
+    float state;
+    int passes;
+public:
+    FilterNode(int passes) : state(0), passes(passes) {
+        for(jack_nframes_t i = 0; i < PERIOD; i++) {
+            buffer[i] = (float)rand() / RAND_MAX - 0.5f;
+        }
+    }
+    void addSource(Processor *source) { sources.push_back(source); }
+    void getSources(std::vector<Processor*> &list) {
+        list.insert(list.end(), sources.begin(), sources.end());
+    }
+    void doProcess(bool, jack_position_t &, jack_nframes_t nframes, jack_nframes_t) {
+        for(int pass = 0; pass < passes; pass++) {
+            for(jack_nframes_t i = 0; i < nframes; i++) {
+                state += 0.1f * (buffer[i] - state);
+                buffer[i] = state;
+            }
+        }
+    }
+    void reposition() {}
+};
+
+struct Timing {
+    double average;
+    double median;
+    double maximum;
+};
+
+Timing run(ProcessGraph *graph, WorkerPool &pool, int periods)
+{
+    jack_position_t pos = jack_position_t();
+    std::vector<double> times;
+    times.reserve(periods);
+    for(int period = 0; period < periods; period++) {
+        auto start = std::chrono::steady_clock::now();
+        if(graph->isParallel()) {
+            pool.run(graph, false, pos, PERIOD, period * PERIOD);
+        } else {
+            graph->run(false, pos, PERIOD, period * PERIOD);
+        }
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for(double time : times) {
+        sum += time;
+    }
+    Timing timing = { sum / periods, times[periods / 2], times.back() };
+    return timing;
+}
+
+int main(int argc, char **argv)
+{
+    int chains = argc > 1 ? atoi(argv[1]) : 64;
+    int depth = argc > 2 ? atoi(argv[2]) : 4;
+    int periods = argc > 3 ? atoi(argv[3]) : 2000;
+    int maxWorkers = argc > 4 ? atoi(argv[4]) : 7;
+
+    std::set<Processor*> processors;
+    FilterNode *sink = new FilterNode(1);
+    processors.insert(sink);
+    for(int c = 0; c < chains; c++) {
+        Processor *previous = 0;
+        for(int d = 0; d < depth; d++) {
+            FilterNode *node = new FilterNode(8);
+            if(previous) {
+                node->addSource(previous);
+            }
+            processors.insert(node);
+            previous = node;
+        }
+        sink->addSource(previous);
+    }
+
+    printf("%d chains of %d nodes, %u frames, %d periods\n", chains, depth, PERIOD, periods);
+    printf("workers  parallel  average us  median us  max us\n");
+    for(int workers = 0; workers <= maxWorkers; workers++) {
+        WorkerPool pool;
+        pool.start(workers, 0);
+        if(pool.size() < workers) {
+            printf("%7d  capped at %d workers on this machine\n", workers, pool.size());
+            pool.stop();
+            break;
+        }
+        ProcessGraph *graph = ProcessGraph::build(processors, workers + 1, pool.size(), 0);
+        run(graph, pool, periods / 10); // warm up
+        Timing timing = run(graph, pool, periods);
+        printf("%7d  %8s  %10.1f  %9.1f  %6.1f\n", workers, graph->isParallel() ? "yes" : "no",
+               timing.average, timing.median, timing.maximum);
+        delete graph;
+        pool.stop();
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Mixer period before and after segment mixing: the frame by frame loop Mixer::doProcess ran
+ * before, walking the control connections every frame, against the process method of an
+ * actual Audio.Mixer, without and with level meters.
+ *
+ * Every input is a mono source routed to every output. A fader controller on input 1 sends
+ * changes spread evenly over the period to all outputs of that input. The mixer ramps a
+ * controller change where the old loop stepped, so the outputs are only compared without
+ * changes.
+ *
+ * usage: mixbench [inputs] [outputs] [period] [periods]
+ */
+#include "mixer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace bipscript;
+
+const unsigned int FADER_CC = 7;
+
+/**
+ * Mono source playing a buffer of noise.
+ */
+class NoiseSource : public audio::Source
+{
+    float *noise;
+    audio::AudioConnection connection;
+public:
+    NoiseSource(jack_nframes_t period) : noise(new float[period]), connection(this, false) {
+        for(jack_nframes_t frame = 0; frame < period; frame++) {
+            noise[frame] = (float)rand() / RAND_MAX - 0.5f;
+        }
+        connection.setBuffer(noise);
+    }
+    ~NoiseSource() { delete[] noise; }
+    float *getAudio() { return noise; }
+    unsigned int getAudioOutputCount() { return 1; }
+    audio::AudioConnection *getAudioConnection(unsigned int) { return &connection; }
+    void doProcess(bool, jack_position_t &, jack_nframes_t, jack_nframes_t) {}
+    void reposition() {}
+};
+
+/**
+ * Controller events of a fader, the same ones every period.
+ */
+class FaderConnection : public midi::MidiConnection
+{
+    std::vector<midi::Event> events;
+public:
+    FaderConnection(midi::Source *source) : midi::MidiConnection(source) {}
+    void setChanges(uint32_t changes, jack_nframes_t period) {
+        events.resize(changes);
+        for(uint32_t c = 0; c < changes; c++) {
+            uint8_t message[] = { midi::Event::TYPE_CONTROL, FADER_CC, (uint8_t)(c % 2 ? 100 : 64) };
+            events[c].unpack(message, 3);
+            events[c].setFrameOffset((c + 1) * period / (changes + 1));
+        }
+    }
+    uint32_t getEventCount() { return events.size(); }
+    midi::Event *getEvent(uint32_t i) { return &events[i]; }
+};
+
+class FaderSource : public midi::Source
+{
+    FaderConnection connection;
+public:
+    FaderSource() : connection(this) {}
+    FaderConnection &getConnection() { return connection; }
+    unsigned int getMidiOutputCount() { return 1; }
+    midi::MidiConnection *getMidiConnection(unsigned int) { return &connection; }
+    void doProcess(bool, jack_position_t &, jack_nframes_t, jack_nframes_t) {}
+    void reposition() {}
+};
+
+/**
+ * The loop Mixer::doProcess ran before: every frame check each control connection for
+ * events at that frame and its mappings for their targets, then every input and output.
+ */
+class FrameMixer
+{
+    struct Mapping {
+        unsigned int cc;
+        unsigned int input;
+        unsigned int output;
+    };
+    uint32_t inputs;
+    uint32_t outputs;
+    jack_nframes_t period;
+    std::vector<float> gainMatrix;
+    std::vector<float*> gain;
+    std::vector<Mapping> mappings;
+    midi::MidiConnection *connection;
+    uint32_t eventCount;
+    uint32_t eventIndex;
+    void updateGains(jack_nframes_t frame) {
+        while(eventIndex < eventCount) {
+            midi::Event *event = connection->getEvent(eventIndex);
+            if(event->getFrameOffset() != (long)frame) {
+                break;
+            }
+            if(event->matches(midi::Event::TYPE_CONTROL)) {
+                for(const Mapping &mapping : mappings) {
+                    if(mapping.cc == event->getDatabyte1()) {
+                        gain[mapping.input][mapping.output] = (float)event->getDatabyte2() / 127;
+                    }
+                }
+            }
+            eventIndex++;
+        }
+    }
+public:
+    std::vector<float*> output;
+    FrameMixer(uint32_t inputs, uint32_t outputs, jack_nframes_t period, float initialGain,
+               midi::MidiConnection *connection)
+        : inputs(inputs), outputs(outputs), period(period), gainMatrix(inputs * outputs, initialGain),
+          connection(connection), eventCount(0), eventIndex(0) {
+        for(uint32_t i = 0; i < inputs; i++) {
+            gain.push_back(&gainMatrix[i * outputs]);
+        }
+        for(uint32_t o = 0; o < outputs; o++) {
+            output.push_back(new float[period]);
+            Mapping mapping = { FADER_CC, 0, o };
+            mappings.push_back(mapping);
+        }
+    }
+    ~FrameMixer() {
+        for(float *buffer : output) { delete[] buffer; }
+    }
+    void process(std::vector<float*> &audio) {
+        for(uint32_t o = 0; o < outputs; o++) {
+            memset(output[o], 0, period * sizeof(float));
+        }
+        eventCount = connection->getEventCount();
+        eventIndex = 0;
+        for(jack_nframes_t frame = 0; frame < period; frame++) {
+            updateGains(frame);
+            for(uint32_t i = 0; i < inputs; i++) {
+                for(uint32_t o = 0; o < outputs; o++) {
+                    if(gain[i][o]) {
+                        output[o][frame] += audio[i][frame] * gain[i][o];
+                    }
+                }
+            }
+        }
+    }
+};
+
+template <class Body>
+double run(Body body, int periods)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int p = 0; p < periods; p++) {
+        body(p);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / periods;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t inputs = argc > 1 ? atoi(argv[1]) : 64;
+    uint32_t outputs = argc > 2 ? atoi(argv[2]) : 16;
+    jack_nframes_t period = argc > 3 ? atoi(argv[3]) : 128;
+    int periods = argc > 4 ? atoi(argv[4]) : 20000;
+    if(!inputs || !outputs || !period || periods <= 0) {
+        printf("usage: mixbench [inputs] [outputs] [period] [periods]\n");
+        return 2;
+    }
+
+    AudioEngine::instance().setSampleRate(48000);
+    audio::AudioConnection::setBufferSize(period);
+    const float initialGain = 0.5f;
+
+    srand(1);
+    std::vector<NoiseSource*> sources;
+    std::vector<float*> audio;
+    audio::Mixer mixer(inputs, outputs);
+    for(uint32_t i = 0; i < inputs; i++) {
+        NoiseSource *source = new NoiseSource(period);
+        sources.push_back(source);
+        audio.push_back(source->getAudio());
+        mixer.connect(*source, initialGain);
+    }
+    FaderSource fader;
+    for(uint32_t o = 0; o < outputs; o++) {
+        mixer.addGainController(fader, FADER_CC, 1, o + 1);
+    }
+    FrameMixer frames(inputs, outputs, period, initialGain, &fader.getConnection());
+
+    jack_position_t pos = jack_position_t();
+    auto mix = [&](int p) { mixer.process(false, pos, period, p * period); };
+    auto mixFrames = [&](int) { frames.process(audio); };
+
+    // both start from the same gains
+    mix(0);
+    frames.process(audio);
+    for(uint32_t o = 0; o < outputs; o++) {
+        float *mixed = mixer.getAudioConnection(o)->getAudio();
+        for(jack_nframes_t frame = 0; frame < period; frame++) {
+            if(std::fabs(frames.output[o][frame] - mixed[frame]) > 1e-4f) {
+                printf("output %u differs at frame %u\n", o, frame);
+                return 1;
+            }
+        }
+    }
+
+    printf("%u inputs, %u outputs, %u frames, %d periods\n", inputs, outputs, period, periods);
+    printf("changes  frames us  mixer us  speedup  metered us\n");
+    const uint32_t changes[] = { 0, 1, 4, 16 };
+    for(uint32_t count : changes) {
+        if(count >= period) {
+            break;
+        }
+        fader.getConnection().setChanges(count, period);
+        mixer.meterRate(0);
+        run(mixFrames, periods / 10); // warm up
+        run(mix, periods / 10);
+        double before = run(mixFrames, periods);
+        double after = run(mix, periods);
+        mixer.meterRate(10);
+        double metered = run(mix, periods);
+        printf("%7u  %9.2f  %8.2f  %6.1fx  %10.2f\n", count, before, after, before / after, metered);
+    }
+    for(NoiseSource *source : sources) {
+        delete source;
+    }
+    return 0;
+}
@@ -46,6 +46,14 @@ HSQOBJECT AudioBeatTrackerObject;
 //
 // Audio.Mixer class
 //
+Mixer *getAudioMixer(HSQUIRRELVM &vm, int index) {
+    SQUserPointer objPtr;
+    if (!SQ_FAILED(sq_getinstanceup(vm, index, (SQUserPointer*)&objPtr, &AudioMixerObject))) {
+        return static_cast<Mixer*>(objPtr);
+    }
+    return 0;
+}
+
 SQInteger AudioMixerCtor(HSQUIRRELVM vm)
 {
     SQInteger numargs = sq_gettop(vm);
@@ -420,6 +428,268 @@ SQInteger AudioMixerscheduleGain(HSQUIRRELVM vm)
     return 0;
 }
 
+//
+// Audio.Mixer scheduleFade
+//
+SQInteger AudioMixerscheduleFade(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 9) {
+        return sq_throwerror(vm, "too many parameters, expected at most 8");
+    }
+    if(numargs < 8) {
+        return sq_throwerror(vm, "insufficient parameters, expected at least 7");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "scheduleFade method needs an instance of Mixer");
+    }
+    Mixer *obj = static_cast<Mixer*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "scheduleFade method called before Audio.Mixer constructor");
+    }
+    // get parameter 1 "input" as integer
+    SQInteger input;
+    if (SQ_FAILED(sq_getinteger(vm, 2, &input))){
+        return sq_throwerror(vm, "argument 1 \"input\" is not of type integer");
+    }
+
+    // get parameter 2 "output" as integer
+    SQInteger output;
+    if (SQ_FAILED(sq_getinteger(vm, 3, &output))){
+        return sq_throwerror(vm, "argument 2 \"output\" is not of type integer");
+    }
+
+    // get parameter 3 "gain" as float
+    SQFloat gain;
+    if (SQ_FAILED(sq_getfloat(vm, 4, &gain))){
+        return sq_throwerror(vm, "argument 3 \"gain\" is not of type float");
+    }
+
+    // get parameter 4 "bar" as integer
+    SQInteger bar;
+    if (SQ_FAILED(sq_getinteger(vm, 5, &bar))){
+        return sq_throwerror(vm, "argument 4 \"bar\" is not of type integer");
+    }
+
+    // get parameter 5 "position" as integer
+    SQInteger position;
+    if (SQ_FAILED(sq_getinteger(vm, 6, &position))){
+        return sq_throwerror(vm, "argument 5 \"position\" is not of type integer");
+    }
+
+    // get parameter 6 "division" as integer
+    SQInteger division;
+    if (SQ_FAILED(sq_getinteger(vm, 7, &division))){
+        return sq_throwerror(vm, "argument 6 \"division\" is not of type integer");
+    }
+
+    // get parameter 7 "length" as integer
+    SQInteger length;
+    if (SQ_FAILED(sq_getinteger(vm, 8, &length))){
+        return sq_throwerror(vm, "argument 7 \"length\" is not of type integer");
+    }
+
+    // 8 parameters passed in
+    if(numargs == 9) {
+
+        // get parameter 8 "curve" as string
+        const SQChar* curve;
+        if (SQ_FAILED(sq_getstring(vm, 9, &curve))){
+            return sq_throwerror(vm, "argument 8 \"curve\" is not of type string");
+        }
+
+        // call the implementation
+        try {
+            obj->scheduleFade(input, output, gain, bar, position, division, length, curve);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    else {
+        // call the implementation
+        try {
+            obj->scheduleFade(input, output, gain, bar, position, division, length);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    // void method, returns no value
+    return 0;
+}
+
+//
+// Audio.Mixer meterRate
+//
+SQInteger AudioMixermeterRate(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 2) {
+        return sq_throwerror(vm, "too many parameters, expected at most 1");
+    }
+    if(numargs < 2) {
+        return sq_throwerror(vm, "insufficient parameters, expected at least 1");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "meterRate method needs an instance of Mixer");
+    }
+    Mixer *obj = static_cast<Mixer*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "meterRate method called before Audio.Mixer constructor");
+    }
+    // get parameter 1 "rate" as float
+    SQFloat rate;
+    if (SQ_FAILED(sq_getfloat(vm, 2, &rate))){
+        return sq_throwerror(vm, "argument 1 \"rate\" is not of type float");
+    }
+
+    // call the implementation
+    try {
+        obj->meterRate(rate);
+    }
+    catch(std::exception const& e) {
+        return sq_throwerror(vm, e.what());
+    }
+
+    // void method, returns no value
+    return 0;
+}
+
+//
+// Audio.Mixer inputLevel
+//
+SQInteger AudioMixerinputLevel(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 3) {
+        return sq_throwerror(vm, "too many parameters, expected at most 2");
+    }
+    if(numargs < 2) {
+        return sq_throwerror(vm, "insufficient parameters, expected at least 1");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "inputLevel method needs an instance of Mixer");
+    }
+    Mixer *obj = static_cast<Mixer*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "inputLevel method called before Audio.Mixer constructor");
+    }
+    // get parameter 1 "input" as integer
+    SQInteger input;
+    if (SQ_FAILED(sq_getinteger(vm, 2, &input))){
+        return sq_throwerror(vm, "argument 1 \"input\" is not of type integer");
+    }
+
+    // return value
+    SQFloat ret;
+    // 2 parameters passed in
+    if(numargs == 3) {
+
+        // get parameter 2 "measure" as string
+        const SQChar* measure;
+        if (SQ_FAILED(sq_getstring(vm, 3, &measure))){
+            return sq_throwerror(vm, "argument 2 \"measure\" is not of type string");
+        }
+
+        // call the implementation
+        try {
+            ret = obj->inputLevel(input, measure);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    else {
+        // call the implementation
+        try {
+            ret = obj->inputLevel(input);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    // push return value
+    sq_pushfloat(vm, ret);
+    return 1;
+}
+
+//
+// Audio.Mixer outputLevel
+//
+SQInteger AudioMixeroutputLevel(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 3) {
+        return sq_throwerror(vm, "too many parameters, expected at most 2");
+    }
+    if(numargs < 2) {
+        return sq_throwerror(vm, "insufficient parameters, expected at least 1");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "outputLevel method needs an instance of Mixer");
+    }
+    Mixer *obj = static_cast<Mixer*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "outputLevel method called before Audio.Mixer constructor");
+    }
+    // get parameter 1 "output" as integer
+    SQInteger output;
+    if (SQ_FAILED(sq_getinteger(vm, 2, &output))){
+        return sq_throwerror(vm, "argument 1 \"output\" is not of type integer");
+    }
+
+    // return value
+    SQFloat ret;
+    // 2 parameters passed in
+    if(numargs == 3) {
+
+        // get parameter 2 "measure" as string
+        const SQChar* measure;
+        if (SQ_FAILED(sq_getstring(vm, 3, &measure))){
+            return sq_throwerror(vm, "argument 2 \"measure\" is not of type string");
+        }
+
+        // call the implementation
+        try {
+            ret = obj->outputLevel(output, measure);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    else {
+        // call the implementation
+        try {
+            ret = obj->outputLevel(output);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    // push return value
+    sq_pushfloat(vm, ret);
+    return 1;
+}
+
 //
 // Audio.OnsetDetector class
 //
@@ -1218,6 +1488,22 @@ void bindAudio(HSQUIRRELVM vm)
     sq_newclosure(vm, &AudioMixerscheduleGain, 0);
     sq_newslot(vm, -3, false);
 
+    sq_pushstring(vm, _SC("scheduleFade"), -1);
+    sq_newclosure(vm, &AudioMixerscheduleFade, 0);
+    sq_newslot(vm, -3, false);
+
+    sq_pushstring(vm, _SC("meterRate"), -1);
+    sq_newclosure(vm, &AudioMixermeterRate, 0);
+    sq_newslot(vm, -3, false);
+
+    sq_pushstring(vm, _SC("inputLevel"), -1);
+    sq_newclosure(vm, &AudioMixerinputLevel, 0);
+    sq_newslot(vm, -3, false);
+
+    sq_pushstring(vm, _SC("outputLevel"), -1);
+    sq_newclosure(vm, &AudioMixeroutputLevel, 0);
+    sq_newslot(vm, -3, false);
+
     // push Mixer to Audio package table
     sq_newslot(vm, -3, false);
 
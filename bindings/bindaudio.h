@@ -23,6 +23,7 @@ namespace bipscript {
 
 namespace audio {
 class AudioConnection;
+class Mixer;
 }
 
 namespace binding
@@ -36,6 +37,7 @@ namespace binding
     extern HSQOBJECT AudioStereoInObject;
     extern HSQOBJECT AudioStereoOutObject;
     extern HSQOBJECT AudioBeatTrackerObject;
+    audio::Mixer *getAudioMixer(HSQUIRRELVM &vm, int index);
     audio::AudioConnection *getAudioOutput(HSQUIRRELVM &vm, int index);
     // release hooks for types in this package
     SQInteger AudioStereoOutRelease(SQUserPointer p, SQInteger size);
@@ -179,8 +179,8 @@ SQInteger Lv2PluginaddController(HSQUIRRELVM vm)
 {
     SQInteger numargs = sq_gettop(vm);
     // check parameter count
-    if(numargs > 6) {
-        return sq_throwerror(vm, "too many parameters, expected at most 5");
+    if(numargs > 7) {
+        return sq_throwerror(vm, "too many parameters, expected at most 6");
     }
     if(numargs < 4) {
         return sq_throwerror(vm, "insufficient parameters, expected at least 3");
@@ -254,6 +254,36 @@ SQInteger Lv2PluginaddController(HSQUIRRELVM vm)
         }
     }
 
+    // 6 parameters passed in
+    else if(numargs == 7) {
+
+        // get parameter 4 "mininum" as integer
+        SQInteger mininum;
+        if (SQ_FAILED(sq_getinteger(vm, 5, &mininum))){
+            return sq_throwerror(vm, "argument 4 \"mininum\" is not of type integer");
+        }
+
+        // get parameter 5 "maximum" as integer
+        SQInteger maximum;
+        if (SQ_FAILED(sq_getinteger(vm, 6, &maximum))){
+            return sq_throwerror(vm, "argument 5 \"maximum\" is not of type integer");
+        }
+
+        // get parameter 6 "curve" as string
+        const SQChar* curve;
+        if (SQ_FAILED(sq_getstring(vm, 7, &curve))){
+            return sq_throwerror(vm, "argument 6 \"curve\" is not of type string");
+        }
+
+        // call the implementation
+        try {
+            obj->addController(*source, cc, symbol, mininum, maximum, curve);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
     else {
         // call the implementation
         try {
@@ -268,6 +298,68 @@ SQInteger Lv2PluginaddController(HSQUIRRELVM vm)
     return 0;
 }
 
+//
+// Lv2.Plugin addControllerTable
+//
+SQInteger Lv2PluginaddControllerTable(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 5) {
+        return sq_throwerror(vm, "too many parameters, expected at most 4");
+    }
+    if(numargs < 5) {
+        return sq_throwerror(vm, "insufficient parameters, expected at least 4");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "addControllerTable method needs an instance of Plugin");
+    }
+    Plugin *obj = static_cast<Plugin*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "addControllerTable method called before Lv2.Plugin constructor");
+    }
+    // get parameter 1 "source" as Midi.Source
+    midi::Source *source = getMidiSource(vm, 2);
+    if(source == 0) {
+        return sq_throwerror(vm, "argument 1 \"source\" is not of type Midi.Source");
+    }
+
+    // get parameter 2 "cc" as integer
+    SQInteger cc;
+    if (SQ_FAILED(sq_getinteger(vm, 3, &cc))){
+        return sq_throwerror(vm, "argument 2 \"cc\" is not of type integer");
+    }
+
+    // get parameter 3 "symbol" as string
+    const SQChar* symbol;
+    if (SQ_FAILED(sq_getstring(vm, 4, &symbol))){
+        return sq_throwerror(vm, "argument 3 \"symbol\" is not of type string");
+    }
+
+    // get parameter 4 "values" as array
+    HSQOBJECT valuesObj;
+    if (SQ_FAILED(sq_getstackobj(vm, 5, &valuesObj))) {
+        return sq_throwerror(vm, "argument 4 \"values\" is not of type array");
+    }
+    if (sq_gettype(vm, 5) != OT_ARRAY) {
+        return sq_throwerror(vm, "argument 4 \"values\" is not of type array");
+    }
+    ScriptArray values(vm, valuesObj);
+
+    // call the implementation
+    try {
+        obj->addControllerTable(*source, cc, symbol, values);
+    }
+    catch(std::exception const& e) {
+        return sq_throwerror(vm, e.what());
+    }
+
+    // void method, returns no value
+    return 0;
+}
+
 //
 // Lv2.Plugin connect
 //
@@ -1211,6 +1303,10 @@ void bindLv2(HSQUIRRELVM vm)
     sq_newclosure(vm, &Lv2PluginaddController, 0);
     sq_newslot(vm, -3, false);
 
+    sq_pushstring(vm, _SC("addControllerTable"), -1);
+    sq_newclosure(vm, &Lv2PluginaddControllerTable, 0);
+    sq_newslot(vm, -3, false);
+
     sq_pushstring(vm, _SC("connect"), -1);
     sq_newclosure(vm, &Lv2Pluginconnect, 0);
     sq_newslot(vm, -3, false);
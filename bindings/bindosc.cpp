@@ -18,10 +18,12 @@
 #include "bindosc.h"
 #include "bindtypes.h"
 #include "bindcommon.h"
+#include "bindaudio.h"
 
 #include "oscinput.h"
 #include "oscmessage.h"
 #include "oscoutput.h"
+#include "mixer.h"
 #include <stdexcept>
 #include <cstring>
 
@@ -690,6 +692,83 @@ SQInteger OscOutputsend(HSQUIRRELVM vm)
     return 0;
 }
 
+//
+// Osc.Output sendLoad
+//
+SQInteger OscOutputsendLoad(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 1) {
+        return sq_throwerror(vm, "too many parameters, expected at most 0");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "sendLoad method needs an instance of Output");
+    }
+    Output *obj = static_cast<Output*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "sendLoad method called before Osc.Output constructor");
+    }
+    // call the implementation
+    try {
+        obj->sendLoad();
+    }
+    catch(std::exception const& e) {
+        return sq_throwerror(vm, e.what());
+    }
+
+    // void method, returns no value
+    return 0;
+}
+
+//
+// Osc.Output sendLevels
+//
+SQInteger OscOutputsendLevels(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 3) {
+        return sq_throwerror(vm, "too many parameters, expected at most 2");
+    }
+    if(numargs < 3) {
+        return sq_throwerror(vm, "insufficient parameters, expected at least 2");
+    }
+    // get "this" pointer
+    SQUserPointer userPtr = 0;
+    if (SQ_FAILED(sq_getinstanceup(vm, 1, &userPtr, 0))) {
+        return sq_throwerror(vm, "sendLevels method needs an instance of Output");
+    }
+    Output *obj = static_cast<Output*>(userPtr);
+    if(!obj) {
+        return sq_throwerror(vm, "sendLevels method called before Osc.Output constructor");
+    }
+    // get parameter 1 "mixer" as Audio.Mixer
+    audio::Mixer *mixer = getAudioMixer(vm, 2);
+    if(mixer == 0) {
+        return sq_throwerror(vm, "argument 1 \"mixer\" is not of type Audio.Mixer");
+    }
+
+    // get parameter 2 "name" as string
+    const SQChar* name;
+    if (SQ_FAILED(sq_getstring(vm, 3, &name))){
+        return sq_throwerror(vm, "argument 2 \"name\" is not of type string");
+    }
+
+    // call the implementation
+    try {
+        obj->sendLevels(*mixer, name);
+    }
+    catch(std::exception const& e) {
+        return sq_throwerror(vm, e.what());
+    }
+
+    // void method, returns no value
+    return 0;
+}
+
 
 void bindOsc(HSQUIRRELVM vm)
 {
@@ -786,6 +865,14 @@ void bindOsc(HSQUIRRELVM vm)
     sq_newclosure(vm, &OscOutputsend, 0);
     sq_newslot(vm, -3, false);
 
+    sq_pushstring(vm, _SC("sendLoad"), -1);
+    sq_newclosure(vm, &OscOutputsendLoad, 0);
+    sq_newslot(vm, -3, false);
+
+    sq_pushstring(vm, _SC("sendLevels"), -1);
+    sq_newclosure(vm, &OscOutputsendLevels, 0);
+    sq_newslot(vm, -3, false);
+
     // push Output to Osc package table
     sq_newslot(vm, -3, false);
 
@@ -69,6 +69,101 @@ SQInteger Systemargument(HSQUIRRELVM vm)
     return 1;
 }
 
+//
+// System bufferSavings
+//
+SQInteger SystembufferSavings(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 1) {
+        return sq_throwerror(vm, "too many parameters, expected at most 0");
+    }
+    // return value
+    SQInteger ret;
+    // call the implementation
+    try {
+        ret = System::getBufferSavings();
+    }
+    catch(std::exception const& e) {
+        return sq_throwerror(vm, e.what());
+    }
+
+    // push return value
+    sq_pushinteger(vm, ret);
+    return 1;
+}
+
+//
+// System dspLoad
+//
+SQInteger SystemdspLoad(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 1) {
+        return sq_throwerror(vm, "too many parameters, expected at most 0");
+    }
+    // return value
+    const SQChar* ret;
+    // call the implementation
+    try {
+        ret = System::getDspLoad();
+    }
+    catch(std::exception const& e) {
+        return sq_throwerror(vm, e.what());
+    }
+
+    // push return value
+    sq_pushstring(vm, ret, strlen(ret));
+    return 1;
+}
+
+//
+// System graph
+//
+SQInteger Systemgraph(HSQUIRRELVM vm)
+{
+    SQInteger numargs = sq_gettop(vm);
+    // check parameter count
+    if(numargs > 2) {
+        return sq_throwerror(vm, "too many parameters, expected at most 1");
+    }
+    // return value
+    const SQChar* ret;
+    // 1 parameters passed in
+    if(numargs == 2) {
+
+        // get parameter 1 "format" as string
+        const SQChar* format;
+        if (SQ_FAILED(sq_getstring(vm, 2, &format))){
+            return sq_throwerror(vm, "argument 1 \"format\" is not of type string");
+        }
+
+        // call the implementation
+        try {
+            ret = System::getGraph(format);
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    else {
+        // call the implementation
+        try {
+            ret = System::getGraph();
+        }
+        catch(std::exception const& e) {
+            return sq_throwerror(vm, e.what());
+        }
+    }
+
+    // push return value
+    sq_pushstring(vm, ret, strlen(ret));
+    return 1;
+}
+
 
 void bindSystem(HSQUIRRELVM vm)
 {
@@ -81,6 +176,21 @@ void bindSystem(HSQUIRRELVM vm)
     sq_newclosure(vm, &Systemargument, 0);
     sq_newslot(vm, -3, false);
 
+    // static method bufferSavings
+    sq_pushstring(vm, _SC("bufferSavings"), -1);
+    sq_newclosure(vm, &SystembufferSavings, 0);
+    sq_newslot(vm, -3, false);
+
+    // static method dspLoad
+    sq_pushstring(vm, _SC("dspLoad"), -1);
+    sq_newclosure(vm, &SystemdspLoad, 0);
+    sq_newslot(vm, -3, false);
+
+    // static method graph
+    sq_pushstring(vm, _SC("graph"), -1);
+    sq_newclosure(vm, &Systemgraph, 0);
+    sq_newslot(vm, -3, false);
+
     // push package "System" to root table
     sq_newslot(vm, -3, false);
 }
@@ -18,6 +18,9 @@
 #define AUDIOCONNECTION_H
 
 #include "source.h"
+#include "audioengine.h"
+#include "bufferpool.h"
+#include "delayline.h"
 #include <atomic>
 #include <stdexcept>
 #include <cstring>
@@ -29,34 +32,76 @@ class Source;
 
 /**
  * Represents a mono audio connection
+ *
+ * Pooled connections get their buffer from the BufferPool when the process graph is installed,
+ * until then they use a zeroed buffer of their own.
  */
 class AudioConnection {
-    static float *dummyBuffer;
+public:
+    /**
+     * What the producer wrote this period so consumers can skip work, the buffer always
+     * holds the actual samples regardless.
+     */
+    enum State { SIGNAL, CONSTANT, SILENT };
+private:
     static jack_nframes_t bufferSize;
     Source *source;    
+    bool pooled;
+    float *scratch; // private until the first slot is applied, other connections never see it
     float *buffer;
+    State state;
 public:
     // static
     static void setBufferSize(jack_nframes_t size) {
-        if(dummyBuffer) {
-            delete[] dummyBuffer;
-        }
-        dummyBuffer = new float[size];
         bufferSize = size;
     }
     static float *getDummyBuffer() {
-        return dummyBuffer;
+        return BufferPool::instance().getSilence();
+    }
+    static jack_nframes_t getBufferSize() {
+        return bufferSize;
     }
     // instance
-    AudioConnection(Source *source, bool allocate = true)
-        : source(source) {
-        if(allocate) {
-            buffer = new float[bufferSize];
-        }
+    AudioConnection(Source *source, bool pooled = true)
+        : source(source), pooled(pooled), scratch(pooled ? new float[bufferSize]() : 0),
+          buffer(scratch), state(SILENT) {}
+    ~AudioConnection() {
+        delete[] scratch;
+    }
+    /**
+     * Free the buffer used before the connection had a slot, called once a graph that
+     * assigns it a slot has been installed.
+     *
+     * Runs in the script thread.
+     */
+    void releaseScratch() {
+        delete[] scratch;
+        scratch = 0;
     }
-    void setBuffer(float *buffer) { this->buffer = buffer; }
+    void setBuffer(float *buffer) {
+        this->buffer = buffer;
+        state = SIGNAL;
+    }
+    bool isPooled() { return pooled; }
     Source *getSource() { return source; }
     float *getAudio() { return buffer; }
+    void setState(State state) { this->state = state; }
+    State getState() { return state; }
+    bool isSilent() { return state == SILENT; }
+    /**
+     * Set the state from the buffer contents, stops at the first sample that differs.
+     *
+     * Runs in the process thread.
+     */
+    State detectState(jack_nframes_t nframes) {
+        float first = buffer[0];
+        for(jack_nframes_t i = 1; i < nframes; i++) {
+            if(buffer[i] != first) {
+                return state = SIGNAL;
+            }
+        }
+        return state = first == 0 ? SILENT : CONSTANT;
+    }
     void clear() {
         std::memset(buffer, 0, sizeof(float) * bufferSize);
     }
@@ -77,18 +122,52 @@ public:
  */
 class AudioConnector {
     std::atomic<AudioConnection *> connection;
+    DelayLine *delayLine; // set by the process thread when a graph is installed
 public:
-    AudioConnector() : connection(0) {}
+    AudioConnector() : connection(0), delayLine(0) {}
     void setConnection(AudioConnection *conn, Source *source) {
-        Source *connSource = conn->getSource();
-        if(connSource == source || connSource->connectsTo(source)) {
+        if(!ConnectionIndex::instance().connect(conn->getSource(), source)) {
             throw std::logic_error("Cannot connect infinite loop");
         }
-        connection.store(conn);
+        AudioConnection *previous = connection.exchange(conn);
+        if(previous) {
+            ConnectionIndex::instance().disconnect(previous->getSource(), source);
+        }
+        AudioEngine::instance().graphChanged();
+    }
+    /**
+     * Drop the connection of an input the owner no longer reads.
+     *
+     * Runs in the script thread.
+     */
+    void clearConnection(Source *source) {
+        AudioConnection *previous = connection.exchange(0);
+        if(previous) {
+            ConnectionIndex::instance().disconnect(previous->getSource(), source);
+        }
     }
     AudioConnection *getConnection() {
         return connection.load();
     }
+    void setDelayLine(DelayLine *line) {
+        delayLine = line;
+    }
+    bool isDelayed() {
+        return delayLine;
+    }
+    /**
+     * Audio of the connection for this period, delayed when the graph lines this input up
+     * with slower paths. Call once per period.
+     *
+     * Runs in the process thread.
+     */
+    float *readAudio(jack_nframes_t nframes) {
+        AudioConnection *conn = connection.load();
+        if(!conn) {
+            return AudioConnection::getDummyBuffer();
+        }
+        return delayLine ? delayLine->process(conn->getAudio(), nframes) : conn->getAudio();
+    }
 };
 
 }}
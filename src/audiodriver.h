@@ -0,0 +1,100 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AUDIODRIVER_H
+#define AUDIODRIVER_H
+
+#include <jack/types.h>
+#include <jack/midiport.h>
+#include <atomic>
+#include <cstddef>
+
+namespace bipscript {
+
+namespace transport {
+class Master;
+}
+
+/**
+ * A system audio or MIDI port registered through an AudioDriver.
+ *
+ * The buffer methods mirror the JACK port API and run in the process thread.
+ */
+class DriverPort
+{
+    std::atomic<jack_nframes_t> latency;
+public:
+    enum Type { AUDIO_INPUT, AUDIO_OUTPUT, MIDI_INPUT, MIDI_OUTPUT };
+    DriverPort() : latency(0) {}
+    virtual ~DriverPort() {}
+    /**
+     * Frames between the graph input and this port, set by the script thread for output ports.
+     */
+    jack_nframes_t getLatency() { return latency.load(); }
+    void setLatency(jack_nframes_t frames) { latency.store(frames); }
+    virtual const char *getName() = 0;
+    virtual void *getBuffer(jack_nframes_t nframes) = 0;
+    // MIDI buffers
+    virtual uint32_t getMidiEventCount(void *buffer) = 0;
+    virtual void getMidiEvent(void *buffer, uint32_t index, jack_midi_event_t &event) = 0;
+    virtual void clearMidiBuffer(void *buffer) = 0;
+    /**
+     * Returns space for an event of the given size at the given frame, or null if the buffer is full.
+     */
+    virtual jack_midi_data_t *reserveMidiEvent(void *buffer, jack_nframes_t time, size_t size) = 0;
+};
+
+/**
+ * Backend that owns the clock and the system ports and calls AudioEngine::process once per period.
+ */
+class AudioDriver
+{
+public:
+    virtual ~AudioDriver() {}
+    /**
+     * Open the backend and start processing, returns non-zero on failure.
+     *
+     * Runs in the main thread.
+     */
+    virtual int activate(const char *clientName) = 0;
+    virtual void shutdown() = 0;
+    virtual jack_nframes_t getSampleRate() = 0;
+    virtual jack_nframes_t getBufferSize() = 0;
+    virtual int getRealtimePriority() { return 0; }
+    // transport
+    virtual bool queryTransport(jack_position_t &pos) = 0;
+    virtual jack_nframes_t getLastFrameTime() = 0;
+    virtual void transportStart() = 0;
+    virtual void transportStop() = 0;
+    virtual void transportLocate(jack_nframes_t frame) = 0;
+    virtual bool setTimebaseMaster(transport::Master *master) = 0;
+    virtual void releaseTimebaseMaster() = 0;
+    // system ports
+    virtual DriverPort *registerPort(const char *name, DriverPort::Type type) = 0;
+    virtual void unregisterPort(DriverPort *port) = 0;
+    virtual void connectPort(DriverPort *port, const char *connection) = 0;
+    virtual void disconnectPort(DriverPort *port, const char *connection) = 0;
+    /**
+     * The latency of some output ports has changed.
+     *
+     * Runs in the script thread.
+     */
+    virtual void latencyChanged() {}
+};
+
+}
+
+#endif // AUDIODRIVER_H
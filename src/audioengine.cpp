@@ -15,14 +15,20 @@
  * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 
 #include "audioengine.h"
+#include "jackdriver.h"
 #include "objectcollector.h"
 #include "scripthost.h"
 #include "audioconnection.h"
 #include "transportmaster.h"
 #include "lv2plugin.h"
+#include "scriptgeneration.h"
+#include "timeline.h"
+#include "rtsafety.h"
 
 using namespace std;
 
@@ -30,7 +36,6 @@ namespace bipscript {
 
 namespace audio {
 
-float *AudioConnection::dummyBuffer = 0;
 jack_nframes_t AudioConnection::bufferSize;
 
 }
@@ -66,87 +71,223 @@ void printPosition(jack_transport_state_t state, jack_position_t *pos, jack_nfra
     cout << "====" << endl;
 }
 
-int jack_process(jack_nframes_t nframes, void *arg)
-{
-    return ((AudioEngine*)arg)->process(nframes);
-}
-
-int sync_callback(jack_transport_state_t state, jack_position_t *pos, void *arg)
-{
-    return ((AudioEngine*)arg)->sync(state, pos);
-}
-
-int buffersize_callback(jack_nframes_t nframes, void* arg)
-{
-    ((AudioEngine*)arg)->setBufferSize(nframes);
-    return 0;
-}
-
 transport::TimeSignature &AudioEngine::getTimeSignature()
 {
     jack_position_t pos;
-    jack_transport_query(client, &pos);
+    driver->queryTransport(pos);
     bool valid = pos.valid & JackTransportBBT;
     currentTimeSignature = transport::TimeSignature(valid, pos.beats_per_bar, pos.beat_type);
     return currentTimeSignature;
 }
 
+/**
+ * Note a new period size, buffers are resized by the script thread before it builds the next
+ * graph and the process thread runs the installed graph in blocks its buffers hold until then.
+ *
+ * Runs in the main thread on activation and in a JACK thread, possibly the process thread,
+ * on a buffer size change.
+ */
 void AudioEngine::setBufferSize(jack_nframes_t size)
 {
+    requestedBufferSize.store(size);
+    // slots and delay lines are sized for the period
+    graphChanged();
+}
+
+/**
+ * Resize buffers for the latest period size.
+ *
+ * Runs in the script thread, or in the main thread before the script starts.
+ *
+ * Allocates slot memory.
+ */
+void AudioEngine::applyBufferSize()
+{
+    jack_nframes_t size = requestedBufferSize.load();
+    if(size == bufferSize) {
+        return;
+    }
     // TODO: generic size listener?
     audio::AudioConnection::setBufferSize(size);
+    audio::BufferPool::instance().setBufferSize(size);
     lv2::PluginCache::instance().setBufferSize(size);
+    bufferSize = size;
 }
 
+/**
+ * Start the driver, JACK unless another driver has been set.
+ *
+ * Runs in the main thread.
+ */
 int AudioEngine::activate(const char *clientName)
 {
-    // connect to Jack
-    if ((client = jack_client_open(clientName, JackNullOption, NULL)) == 0) {
-        return 1;
+    if(!driver) {
+        driver = new JackDriver();
     }
+    int status = driver->activate(clientName);
+    applyBufferSize();
+    return status;
+}
 
-    // get sample rate and buffer size
-    sampleRate = jack_get_sample_rate(client);
-    setBufferSize(jack_get_buffer_size(client));
+/**
+ * Start the process workers at the priority of the process thread, called by the driver
+ * once it knows that priority but before the first period.
+ *
+ * Runs in the main thread.
+ */
+void AudioEngine::startWorkers()
+{
+    if(workerCount) {
+        workerPool.start(workerCount, driver->getRealtimePriority());
+    }
+}
 
-    // Jack callbacks
-    jack_set_process_callback(client, jack_process, this);
-    jack_set_sync_callback(client, sync_callback, this);
-    jack_set_buffer_size_callback(client, &buffersize_callback, this);
+void AudioEngine::shutdown()
+{
+    driver->shutdown();
+    workerPool.stop();
+}
 
-    // activate jack
-    if (jack_activate(client)) {
-        return 1;
+/**
+ * Rebuild the processor graph if processors or connections have changed and pass it on to
+ * the process thread with a single pointer exchange. A graph the process thread has not
+ * picked up yet is replaced and deleted here.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates ProcessGraph.
+ */
+void AudioEngine::updateGraph()
+{
+    reclaim();
+    applyBufferSize();
+    uint32_t version = graphVersion.load();
+    if(version == builtVersion) {
+        return;
     }
+    ProcessGraph *graph;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        graph = ProcessGraph::build(registeredProcessors, version, workerPool.size(),
+                                    publishedGraphs.empty() ? 0 : publishedGraphs.back());
+    }
+    // report the latency of the system outputs
+    bool latencyChanged = false;
+    for(auto &port : graph->getPortLatencies()) {
+        if(port.port->getLatency() != port.latency) {
+            port.port->setLatency(port.latency);
+            latencyChanged = true;
+        }
+    }
+    if(latencyChanged && driver) {
+        driver->latencyChanged();
+    }
+    publishedGraphs.push_back(graph);
+    ProcessGraph *replaced = pendingGraph.exchange(graph);
+    if(replaced) {
+        publishedGraphs.erase(std::find(publishedGraphs.begin(), publishedGraphs.end(), replaced));
+        delete replaced;
+    }
+    builtVersion = version;
+}
 
-    return 0;
+/**
+ * Write the latest graph built from the script as DOT or JSON, returns false if there is none.
+ *
+ * Runs in the script thread.
+ */
+bool AudioEngine::describeGraph(std::ostream &out, bool json)
+{
+    updateGraph();
+    if(publishedGraphs.empty()) {
+        return false;
+    }
+    publishedGraphs.back()->describe(out, json);
+    return true;
 }
 
-void AudioEngine::shutdown()
+/**
+ * Write the graph to bipscript-graph.dot and bipscript-graph.json in the working folder.
+ *
+ * Runs in the script thread.
+ */
+void AudioEngine::dumpGraphIfRequested()
 {
-    jack_deactivate(client);
-    jack_client_close(client);
+    if(!graphDumpRequested.exchange(false)) {
+        return;
+    }
+    std::ofstream dot("bipscript-graph.dot");
+    std::ofstream json("bipscript-graph.json");
+    if(!dot || !json || !describeGraph(dot, false) || !describeGraph(json, true)) {
+        std::cerr << "warning: could not write the processor graph" << std::endl;
+        return;
+    }
+    std::cerr << "processor graph written to bipscript-graph.dot and bipscript-graph.json" << std::endl;
 }
 
-void printPorts(jack_client_t *client) {
-    const char** foo = jack_get_ports(client, 0, 0, 0 );
-    for (int i = 0; foo && foo[i]; ++i) {
-        cout << "- found port " << foo[i] << endl;
+/**
+ * Delete the graphs and removed processors the process thread can no longer reach, that is
+ * everything older than the graph it has installed, and the scratch buffers of connections
+ * that graph has given a slot.
+ *
+ * Runs in the script thread.
+ */
+void AudioEngine::reclaim()
+{
+    uint32_t installed = installedVersion.load(std::memory_order_acquire);
+    for(auto it = publishedGraphs.begin(); it != publishedGraphs.end();) {
+        if((*it)->getVersion() < installed) {
+            delete *it;
+            it = publishedGraphs.erase(it);
+        } else {
+            // connections in the installed graph now point at their slots
+            if((*it)->getVersion() == installed) {
+                (*it)->releaseScratch();
+            }
+            it++;
+        }
+    }
+    std::vector<Processor*> unreachable;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for(auto it = removedProcessors.begin(); it != removedProcessors.end();) {
+            if(it->version <= installed) {
+                unreachable.push_back(it->processor);
+                it = removedProcessors.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+    // processors may unregister ports, delete outside the lock
+    for(Processor *processor : unreachable) {
+        delete processor;
     }
 }
 
-void timebase_callback(jack_transport_state_t state, jack_nframes_t nframes,
-     jack_position_t *pos, int new_pos, void *arg)
+/**
+ * Read the processing time of every registered processor since the last collection.
+ *
+ * Runs in the script thread.
+ */
+void AudioEngine::collectLoad(std::vector<ProcessorLoadEntry> &entries)
 {
-    ((transport::Master*)arg)->setTime(state, nframes, pos, new_pos);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for(Processor *processor : registeredProcessors) {
+        ProcessorLoadEntry entry;
+        entry.label = processor->getLabel();
+        processor->collectLoad(entry.stats);
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const ProcessorLoadEntry &a, const ProcessorLoadEntry &b) { return a.label < b.label; });
 }
 
 transport::Master *AudioEngine::getTransportMaster(double bpm, float beatsPerBar, float beatUnit)
 {
     if(!transportMaster) {
         transportMaster = new transport::Master(bpm, beatsPerBar, beatUnit);
-        int error = jack_set_timebase_callback(client, 0, &timebase_callback, transportMaster);
-        if (error) {
+        if (!driver->setTimebaseMaster(transportMaster)) {
             throw std::logic_error("Cannot create transport master");
         }
     }
@@ -155,7 +296,7 @@ transport::Master *AudioEngine::getTransportMaster(double bpm, float beatsPerBar
 
 void AudioEngine::releaseTransportMaster()
 {    
-    jack_release_timebase(client);
+    driver->releaseTimebaseMaster();
     transportMaster = 0;
 }
 
@@ -172,6 +313,21 @@ int AudioEngine::sync(jack_transport_state_t state, jack_position_t *pos)
         runningFrame = 0;
     }
 
+    // timelines hold the whole script: move the cursors instead of rerunning
+    else if(pos->frame != runningFrame && EventTimelines::instance().isEnabled()) {
+        uint32_t count = currentGraph ? currentGraph->size() : 0;
+        for(uint32_t i = 0; i < count; i++) {
+            currentGraph->getProcessor(i)->relocate();
+        }
+        runningFrame = pos->frame;
+    }
+
+    // jumped backwards with seamless restarts: rerun in the background and keep playing
+    else if(pos->frame < runningFrame && seamlessRestart) {
+        ScriptHost::instance().restartSeamless();
+        runningFrame = 0;
+    }
+
     // if we've jumped backwards, need to reset
     else if(pos->frame < runningFrame) {
         if(!reposition(0)) {
@@ -189,6 +345,79 @@ int AudioEngine::sync(jack_transport_state_t state, jack_position_t *pos)
 }
 
 
+/**
+ * Frames from the given position to the start of the next bar, zero at the start of a bar.
+ */
+static double framesToBar(jack_position_t &pos)
+{
+    double ticksPerBar = pos.beats_per_bar * pos.ticks_per_beat;
+    double ticks = ticksPerBar - ((pos.beat - 1) * pos.ticks_per_beat + pos.tick);
+    if(ticks >= ticksPerBar) {
+        return 0;
+    }
+    return ticks * pos.frame_rate * 60.0 / (pos.beats_per_minute * pos.ticks_per_beat);
+}
+
+/**
+ * Start playing the generation of a completed seamless rerun when a bar starts in this period,
+ * or right away when the transport is stopped. With a crossfade the outputs fade out at the
+ * end of the period before the swap and fade in at the start of the swap period.
+ *
+ * Runs in the process thread.
+ */
+void AudioEngine::swapGeneration(bool rolling, jack_position_t &pos, jack_nframes_t nframes)
+{
+    ScriptGeneration &generations = ScriptGeneration::instance();
+    uint32_t completed = generations.getCompleted();
+    outputFade = FADE_NONE;
+    if(completed <= generations.getPlaying()) {
+        fadedOut = false;
+        return;
+    }
+    fadeLength = crossfadeMillis * sampleRate / 1000;
+    if(fadeLength > nframes) {
+        fadeLength = nframes;
+    }
+    bool onBar = rolling && (pos.valid & JackPositionBBT);
+    double frames = onBar ? framesToBar(pos) : 0;
+    if(frames < nframes && (fadedOut || !fadeLength || !rolling)) {
+        generations.swap(completed);
+        outputFade = fadeLength && rolling ? FADE_IN : FADE_NONE;
+        fadedOut = false;
+    } else if(fadeLength && frames >= nframes && frames < 2 * nframes) {
+        outputFade = FADE_OUT;
+        fadedOut = true;
+    } else {
+        fadedOut = false;
+    }
+}
+
+/**
+ * Install the pending graph unless it belongs to a generation that is not playing yet.
+ *
+ * Runs in the process thread.
+ */
+void AudioEngine::installGraph()
+{
+    ProcessGraph *graph = pendingGraph.exchange(0, std::memory_order_acq_rel);
+    if(!graph) {
+        return;
+    }
+    if(graph->getGeneration() > ScriptGeneration::instance().getPlaying()) {
+        // put it back, if the script thread published a newer graph meanwhile it reclaims this one
+        ProcessGraph *expected = 0;
+        pendingGraph.compare_exchange_strong(expected, graph, std::memory_order_acq_rel);
+        return;
+    }
+    if(currentGraph) {
+        currentGraph->clearDelays();
+    }
+    currentGraph = graph;
+    graph->applyBuffers();
+    graph->applyDelays();
+    installedVersion.store(graph->getVersion(), std::memory_order_release);
+}
+
 /**
  * Called when a reposition has been requested so objects can flush/recycle queued events.
  *
@@ -200,17 +429,10 @@ int AudioEngine::sync(jack_transport_state_t state, jack_position_t *pos)
 // 
 bool AudioEngine::reposition(uint16_t attempt)
 {
-    // remove deleted processors
-    Processor *done;
-    while(deletedProcessors.pop(done)) {
-        activeProcessors.remove(done);
-        ObjectCollector::scriptCollector().recycle(done);
-    }
+    uint32_t count = currentGraph ? currentGraph->size() : 0;
     if(!attempt) { // first run- notify
-        Processor *obj = activeProcessors.getFirst();
-        while(obj) {
-            obj->reposition();
-            obj = activeProcessors.getNext(obj);
+        for(uint32_t i = 0; i < count; i++) {
+            currentGraph->getProcessor(i)->reposition();
         }
     }
     // check that the script is ready
@@ -218,12 +440,10 @@ bool AudioEngine::reposition(uint16_t attempt)
         return false; // it's not
     }
     // check script objects are ready
-    Processor *obj = activeProcessors.getFirst();
-    while(obj) {
-        if(!obj->repositionComplete()) {
+    for(uint32_t i = 0; i < count; i++) {
+        if(!currentGraph->getProcessor(i)->repositionComplete()) {
             return false;
         }
-        obj = activeProcessors.getNext(obj);
     }
 
     // ready to roll
@@ -232,38 +452,93 @@ bool AudioEngine::reposition(uint16_t attempt)
 }
 
 
+/**
+ * Move a rolling transport position the given number of frames ahead, to the start of a block.
+ */
+static void advancePosition(jack_position_t &pos, jack_nframes_t frames)
+{
+    pos.frame += frames;
+    if(!(pos.valid & JackPositionBBT)) {
+        return;
+    }
+    double ticks = pos.tick + frames * pos.beats_per_minute * pos.ticks_per_beat / (60.0 * pos.frame_rate);
+    int32_t beats = ticks / pos.ticks_per_beat;
+    pos.tick = ticks - beats * pos.ticks_per_beat + 0.5;
+    if(pos.tick >= pos.ticks_per_beat) {
+        pos.tick = 0;
+        beats++;
+    }
+    pos.beat += beats;
+    while(pos.beat > pos.beats_per_bar) {
+        pos.beat -= pos.beats_per_bar;
+        pos.bar++;
+        pos.bar_start_tick += pos.beats_per_bar * pos.ticks_per_beat;
+    }
+}
+
 int AudioEngine::process(jack_nframes_t nframes)
-{   
+{
+    uint64_t start = ProcessorLoad::now();
+    RtSafety::enterProcess();
+
     // check jack transport state, are we rolling?
     jack_position_t pos;
-    bool rolling(jack_transport_query(client, &pos) == JackTransportRolling);
+    bool rolling = driver->queryTransport(pos);
 
     // update running position
     if(rolling) {
         runningFrame = pos.frame;
     }
 
-    jack_nframes_t time = jack_last_frame_time(client);
+    jack_nframes_t time = driver->getLastFrameTime();
 
-    // remove deleted processors
-    Processor *done;
-    while(deletedProcessors.pop(done)) {
-        activeProcessors.remove(done);
-        ObjectCollector::scriptCollector().recycle(done);
+    // swap to a completed script rerun at a bar boundary
+    swapGeneration(rolling, pos, nframes);
+
+    // pick up the latest graph of the generation playing
+    installGraph();
+
+    // run the graph once per block, the whole period unless a block size is set
+    jack_nframes_t block = blockSize && blockSize < nframes ? blockSize : nframes;
+    // after a buffer size increase until the script thread has resized the buffers
+    jack_nframes_t maxFrames = currentGraph ? currentGraph->getMaxFrames() : 0;
+    if(maxFrames && block > maxFrames) {
+        block = maxFrames;
     }
-    // run active processors
-    Processor *obj = activeProcessors.getFirst();
-    while(obj) {
-        obj->process(rolling, pos, nframes, time);
-        obj = activeProcessors.getNext(obj);
+    periodFrames = nframes;
+    for(blockOffset = 0; currentGraph && blockOffset < nframes; blockOffset += block) {
+        jack_nframes_t frames = nframes - blockOffset < block ? nframes - blockOffset : block;
+        jack_position_t blockPos = pos;
+        if(rolling && blockOffset) {
+            advancePosition(blockPos, blockOffset);
+        }
+        // producers that feed a single output port render into its buffer
+        currentGraph->applyAliases(nframes, blockOffset);
+        // run the graph in parallel if it is still current
+        if(currentGraph->isParallel() && currentGraph->getVersion() == graphVersion.load()) {
+            workerPool.run(currentGraph, rolling, blockPos, frames, time + blockOffset);
+        }
+        // otherwise run the schedule in order
+        else {
+            currentGraph->run(rolling, blockPos, frames, time + blockOffset);
+        }
+    }
+    blockOffset = 0;
+
+    // record processor load once per period, not per block
+    if(currentGraph) {
+        currentGraph->endPeriod();
     }
 
-    // push out objects to delete
-    ObjectCollector::scriptCollector().update();
+    // hand off objects to delete, bounded per period
+    ObjectCollector::scriptCollector().update(ObjectCollector::PERIOD_BUDGET);
 
-    // free process-allocated objects
-    ObjectCollector::processCollector().free();
+    // free process-allocated objects, bounded per period
+    ObjectCollector::processCollector().free(ObjectCollector::PERIOD_BUDGET);
 
+    int32_t bar = rolling && (pos.valid & JackPositionBBT) ? pos.bar : 0;
+    deadlineMonitor.record(ProcessorLoad::now() - start, nframes, sampleRate, bar);
+    RtSafety::leaveProcess();
     return 0;
 }
 
@@ -19,8 +19,16 @@
 
 #include <jack/jack.h>
 
+#include "audiodriver.h"
 #include "timesignature.h"
 #include "processor.h"
+#include "processgraph.h"
+#include "workerpool.h"
+#include "deadlinemonitor.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace bipscript {
 
@@ -28,10 +36,25 @@ namespace transport {
 class Master;
 }
 
+struct ProcessorLoadEntry
+{
+    std::string label;
+    LoadStats stats;
+};
+
+struct RemovedProcessor
+{
+    Processor *processor;
+    uint32_t version; // first graph version without this processor
+};
+
 class AudioEngine
 {
-    // Jack client + info
-    jack_client_t *client;
+public:
+    enum OutputFade { FADE_NONE, FADE_OUT, FADE_IN };
+private:
+    // driver + info
+    AudioDriver *driver;
     jack_nframes_t sampleRate;
 
     // running location
@@ -42,15 +65,59 @@ class AudioEngine
     unsigned int multiplePeriodRestart;
     transport::TimeSignature currentTimeSignature;
 
-    // processors
-    QueueList<Processor> activeProcessors;
-    boost::lockfree::spsc_queue<Processor*> deletedProcessors; // TODO: also a QueueList?
+    // seamless restart
+    bool seamlessRestart;
+    float crossfadeMillis;
+    OutputFade outputFade; // process thread
+    jack_nframes_t fadeLength; // process thread
+    bool fadedOut; // process thread
+
+    // processor registry, the process thread only sees processors through the current graph
+    std::mutex registryMutex;
+    std::set<Processor*> registeredProcessors;
+    std::vector<RemovedProcessor> removedProcessors;
+
+    // processor graph
+    std::atomic<uint32_t> graphVersion;
+    uint32_t builtVersion; // script thread
+    std::vector<ProcessGraph*> publishedGraphs; // script thread
+    std::atomic<ProcessGraph*> pendingGraph; // script thread -> process thread
+    std::atomic<uint32_t> installedVersion; // process thread -> script thread
+    ProcessGraph *currentGraph; // process thread
+
+    // parallel execution
+    uint16_t workerCount;
+    WorkerPool workerPool;
+
+    // callback timing
+    DeadlineMonitor deadlineMonitor;
+    std::atomic<bool> graphDumpRequested;
+
+    // period size from the driver, applied by the script thread
+    std::atomic<jack_nframes_t> requestedBufferSize;
+    jack_nframes_t bufferSize; // script thread
+
+    // fixed internal blocks
+    jack_nframes_t blockSize; // 0 = one block per period
+    jack_nframes_t periodFrames; // process thread
+    jack_nframes_t blockOffset; // process thread
+
+    // smallest part of a period a processor runs separately for a scheduled event, 0 = never split
+    jack_nframes_t subBlockMinimum;
 
     // private methods
     bool reposition(uint16_t attempt);
+    void reclaim();
+    void applyBufferSize();
+    void swapGeneration(bool rolling, jack_position_t &pos, jack_nframes_t nframes);
+    void installGraph();
 
     // singleton
-    AudioEngine() : client(0), activeProcessors(128), deletedProcessors(16) {}
+    AudioEngine() : driver(0), transportMaster(0), seamlessRestart(false), crossfadeMillis(0),
+        outputFade(FADE_NONE), fadeLength(0), fadedOut(false), graphVersion(1), builtVersion(0), pendingGraph(0),
+        installedVersion(0), currentGraph(0), workerCount(0), graphDumpRequested(false),
+        requestedBufferSize(0), bufferSize(0), blockSize(0),
+        periodFrames(0), blockOffset(0), subBlockMinimum(32) {}
     AudioEngine(AudioEngine const&);
     void operator=(AudioEngine const&);
 public:
@@ -63,57 +130,130 @@ public:
     jack_nframes_t getSampleRate() {
         return sampleRate;
     }
+    void setSampleRate(jack_nframes_t rate) {
+        sampleRate = rate;
+    }
     bool getPosition(jack_position_t &jack_pos) {
-        return jack_transport_query(client, &jack_pos) == JackTransportRolling;
+        return driver->queryTransport(jack_pos);
     }
     transport::TimeSignature &getTimeSignature();
     void setBufferSize(jack_nframes_t size);
+    void setWorkerCount(uint16_t count) {
+        workerCount = count;
+    }
+    void setBlockSize(jack_nframes_t frames) {
+        blockSize = frames;
+    }
+    /**
+     * Buffer of a system port for the whole period, processors add the block offset.
+     *
+     * Runs in the process thread.
+     */
+    void *getPortBuffer(DriverPort *port) {
+        return port->getBuffer(periodFrames);
+    }
+    jack_nframes_t getPeriodFrames() {
+        return periodFrames;
+    }
+    jack_nframes_t getBlockOffset() {
+        return blockOffset;
+    }
+    void setSubBlockMinimum(jack_nframes_t frames) {
+        subBlockMinimum = frames;
+    }
+    jack_nframes_t getSubBlockMinimum() {
+        return subBlockMinimum;
+    }
+    void setDriver(AudioDriver *driver) {
+        this->driver = driver;
+    }
+    void setSeamlessRestart(bool seamless, float crossfadeMillis) {
+        this->seamlessRestart = seamless;
+        this->crossfadeMillis = crossfadeMillis;
+    }
+    /**
+     * Fade system outputs apply in this period around a generation swap.
+     *
+     * Runs in the process thread.
+     */
+    OutputFade getOutputFade(jack_nframes_t &length) {
+        length = fadeLength;
+        return outputFade;
+    }
+    void startWorkers();
+    DeadlineMonitor &getDeadlineMonitor() {
+        return deadlineMonitor;
+    }
     void addProcessor(Processor *obj) {
-        activeProcessors.add(obj);
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registeredProcessors.insert(obj);
+        }
+        graphChanged();
     }
     void removeProcessor(Processor *obj) {
-        while(!deletedProcessors.push(obj));
+        // the processor stays alive until the process thread runs a graph without it
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registeredProcessors.erase(obj);
+        RemovedProcessor removed = { obj, graphVersion.fetch_add(1) + 1 };
+        removedProcessors.push_back(removed);
     }
+    void graphChanged() {
+        graphVersion.fetch_add(1);
+    }
+    void updateGraph();
+    bool describeGraph(std::ostream &out, bool json);
+    /**
+     * Ask for graph files at the next script thread flush, safe to call from a signal handler.
+     */
+    void requestGraphDump() {
+        graphDumpRequested.store(true);
+    }
+    void dumpGraphIfRequested();
+    void collectLoad(std::vector<ProcessorLoadEntry> &entries);
     // public methods
     int activate(const char *clientName);
     int process(jack_nframes_t nframes);
     int sync(jack_transport_state_t state, jack_position_t *pos);
+    void xrun() {
+        deadlineMonitor.xrun();
+    }
     void shutdown();
 
     // system ports
-    jack_port_t *registerMidiInputPort(const char *name) {
-        return jack_port_register(client, name, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+    DriverPort *registerMidiInputPort(const char *name) {
+        return driver->registerPort(name, DriverPort::MIDI_INPUT);
     }
-    jack_port_t *registerMidiOutputPort(const char *name) {
-        return jack_port_register(client, name, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+    DriverPort *registerMidiOutputPort(const char *name) {
+        return driver->registerPort(name, DriverPort::MIDI_OUTPUT);
     }
-    jack_port_t *registerAudioInputPort(const char *name) {
-        return jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    DriverPort *registerAudioInputPort(const char *name) {
+        return driver->registerPort(name, DriverPort::AUDIO_INPUT);
     }
-    jack_port_t *registerAudioOutputPort(const char *name) {
-        return jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    DriverPort *registerAudioOutputPort(const char *name) {
+        return driver->registerPort(name, DriverPort::AUDIO_OUTPUT);
     }
-    void connectPort(jack_port_t *port, const char* connection) {
-        jack_connect(client, jack_port_name(port), connection);
+    void connectPort(DriverPort *port, const char* connection) {
+        driver->connectPort(port, connection);
     }
-    void connectPort(const char *connection, jack_port_t *port) {
-        jack_connect(client, connection, jack_port_name(port));
+    void connectPort(const char *connection, DriverPort *port) {
+        driver->connectPort(port, connection);
     }
-    void disconnectPort(jack_port_t *port, const char* connection) {
-        jack_disconnect(client, jack_port_name(port), connection);
+    void disconnectPort(DriverPort *port, const char* connection) {
+        driver->disconnectPort(port, connection);
     }
-    void unregisterPort(jack_port_t *port) {
-        jack_port_unregister(client, port);
+    void unregisterPort(DriverPort *port) {
+        driver->unregisterPort(port);
     }
     // transport
     void transportStop() {
-        jack_transport_stop(client);
+        driver->transportStop();
     }
     void transportStart() {
-        jack_transport_start(client);
+        driver->transportStart();
     }
     void transportRelocate(jack_nframes_t frame) {
-        jack_transport_locate(client, frame);
+        driver->transportLocate(frame);
     }
     transport::Master *getTransportMaster(double bpm, float beatsPerBar, float beatUnit);
     void releaseTransportMaster();
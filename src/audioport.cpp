@@ -17,7 +17,9 @@
 
 #include "audioport.h"
 #include "audioengine.h"
+#include "scripthost.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace bipscript {
@@ -26,16 +28,17 @@ namespace audio {
 AudioInputPort *AudioInputPortCache::getAudioInputPort(const char *name, const char *connection)
 {
     // see if port already exists in map
-    int key = std::hash<std::string>()(name);
+    std::string fullName = ScriptHost::instance().portName(name);
+    int key = std::hash<std::string>()(fullName);
     AudioInputPort *port = findObject(key);
     if (!port) {
-        // create new jack port
-        jack_port_t *jackPort = AudioEngine::instance().registerAudioInputPort(name);
-        if(!jackPort) {
+        // create new system port
+        DriverPort *driverPort = AudioEngine::instance().registerAudioInputPort(fullName.c_str());
+        if(!driverPort) {
             throw "Failed to register port ";
         }
         // add to map
-        port = new AudioInputPort(jackPort);
+        port = new AudioInputPort(driverPort);
         registerObject(key, port);
         // auto connect output port
     }
@@ -51,13 +54,40 @@ AudioOutputPort::~AudioOutputPort()
 }
 
 void AudioOutputPort::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time) {
-    float *buffer = (float*)jack_port_get_buffer(port, nframes);
+    AudioEngine &engine = AudioEngine::instance();
+    jack_nframes_t offset = engine.getBlockOffset();
+    float *buffer = (float*)engine.getPortBuffer(port) + offset;
     AudioConnection *connection = audioInput.load();
-    if(connection) {
-        connection->getSource()->process(rolling, pos, nframes, time);
+    AudioConnection::State state = connection ? connection->getState() : AudioConnection::SILENT;
+    if(connection && connection->getAudio() == buffer) {
+        // the producer rendered into the port buffer
+        if(state == AudioConnection::SILENT) {
+            return;
+        }
+    } else if(state == AudioConnection::SIGNAL) {
         memcpy(buffer, connection->getAudio(), nframes * sizeof(float)); // TODO: std::copy?
+    } else if(state == AudioConnection::CONSTANT) {
+        std::fill(buffer, buffer + nframes, connection->getAudio()[0]);
     } else {
         memset(buffer, 0, nframes * sizeof(float));
+        return;
+    }
+    // fade around a seamless restart
+    jack_nframes_t length;
+    AudioEngine::OutputFade fade = engine.getOutputFade(length);
+    if(fade == AudioEngine::FADE_OUT) {
+        // fade spans the end of the period
+        jack_nframes_t fadeStart = engine.getPeriodFrames() - length;
+        for(jack_nframes_t i = 0; i < nframes; i++) {
+            jack_nframes_t frame = offset + i;
+            if(frame >= fadeStart) {
+                buffer[i] *= (float)(length - 1 - (frame - fadeStart)) / length;
+            }
+        }
+    } else if(fade == AudioEngine::FADE_IN) {
+        for(jack_nframes_t i = 0; i < nframes && offset + i < length; i++) {
+            buffer[i] *= (float)(offset + i) / length;
+        }
     }
 }
 
@@ -73,16 +103,17 @@ void AudioOutputPort::systemConnect(const char *connection) {
 
 AudioOutputPort *AudioOutputPortCache::getAudioOutputPort(const char* portName, const char* connection)
 {
-    int key = std::hash<std::string>()(portName);
+    std::string fullName = ScriptHost::instance().portName(portName);
+    int key = std::hash<std::string>()(fullName);
     // see if port already exists in map
     AudioOutputPort *port = findObject(key);
     if(!port) {
         // create system port
-        jack_port_t *jackPort = AudioEngine::instance().registerAudioOutputPort(portName);
-        if(!jackPort) {
-            throw std::logic_error(std::string("Failed to register port ") + portName);
+        DriverPort *driverPort = AudioEngine::instance().registerAudioOutputPort(fullName.c_str());
+        if(!driverPort) {
+            throw std::logic_error(std::string("Failed to register port ") + fullName);
         }
-        port = new AudioOutputPort(jackPort);
+        port = new AudioOutputPort(driverPort);
 		registerObject(key, port);
     }
     if(connection) {
@@ -109,14 +140,14 @@ void AudioStereoOutput::connect(Source &source) {
 
 void AudioStereoInput::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time)
 {
-    portLeft->process(rolling, pos, nframes, time);
-    portRight->process(rolling, pos, nframes, time);
+    // both ports are scheduled as sources of this object
 }
 
 void AudioStereoInput::reset(std::string name, const char *connectLeft, const char *connectRight)
 {
     portLeft = AudioInputPortCache::instance().getAudioInputPort((name + "L").c_str(), connectLeft);
     portRight = AudioInputPortCache::instance().getAudioInputPort((name + "R").c_str(), connectRight);
+    AudioEngine::instance().graphChanged();
 }
 
 AudioConnection *AudioStereoInput::getAudioConnection(unsigned int index)
@@ -132,7 +163,8 @@ AudioConnection *AudioStereoInput::getAudioConnection(unsigned int index)
 
 AudioStereoInput *AudioStereoInputCache::getAudioStereoInput(const char *name, const char *connectLeft, const char *connectRight)
 {
-    int key = std::hash<std::string>()(name);
+    // the ports are prefixed by the port cache
+    int key = std::hash<std::string>()(ScriptHost::instance().portName(name));
     AudioStereoInput *input = findObject(key);
     if(!input) {
         input = new AudioStereoInput(name, connectLeft, connectRight);
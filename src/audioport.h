@@ -31,20 +31,24 @@ namespace audio {
 
 class AudioInputPort : public Source
 {
-    jack_port_t* port;
+    DriverPort *port;
     AudioConnection connection;
 public:
-    AudioInputPort(jack_port_t *jackPort)
-        : port(jackPort), connection(this, false) { }
+    AudioInputPort(DriverPort *driverPort)
+        : port(driverPort), connection(this, false) { }
     void systemConnect(const char *name) {
         AudioEngine::instance().connectPort(name, port);
     }
     // Source interface
-    bool connectsTo(AbstractSource *) { return false; }
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time) {
-        connection.setBuffer((float*)jack_port_get_buffer (port, nframes));
+        AudioEngine &engine = AudioEngine::instance();
+        connection.setBuffer((float*)engine.getPortBuffer(port) + engine.getBlockOffset());
+        connection.detectState(nframes);
     }
     void reposition() {}
+    std::string getLabel() {
+        return std::string("Audio.SystemIn ") + port->getName();
+    }
     // AudioSource interface
     unsigned int getAudioOutputCount() { return 1; }
     AudioConnection *getAudioConnection(unsigned int) {
@@ -68,24 +72,35 @@ public:
 // represents a system output port
 class AudioOutputPort : public Processor
 {
-    jack_port_t* port;
+    DriverPort *port;
     std::atomic<AudioConnection *> audioInput;
     std::string connected;
 public:
-    AudioOutputPort(jack_port_t *jackPort) : port(jackPort), audioInput(0) { }
+    AudioOutputPort(DriverPort *driverPort) : port(driverPort), audioInput(0) { }
     ~AudioOutputPort();
-    jack_port_t* getJackPort() { return port; }
+    DriverPort *getDriverPort() { return port; }
+    AudioConnection *getConnection() { return audioInput.load(); }
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
     void connect(Source &source) {
         connect(source.getAudioConnection(0));
     }
     void connect(AudioConnection &connection) {
-        this->audioInput.store(&connection);
+        connect(&connection);
     }
     void connect(AudioConnection *connection) {
         this->audioInput.store(connection);
+        AudioEngine::instance().graphChanged();
+    }
+    void getSources(std::vector<Processor*> &sources) {
+        AudioConnection *connection = audioInput.load();
+        if(connection) {
+            sources.push_back(connection->getSource());
+        }
     }
     void reposition() {}
+    std::string getLabel() {
+        return std::string("Audio.SystemOut ") + port->getName();
+    }
     void systemConnect(const char *connection);
 };
 
@@ -129,9 +144,13 @@ public:
     }
     void reset(std::string name, const char *connectLeft, const char *connectRight);
     // Source interface
-    bool connectsTo(AbstractSource *) { return false; }
+    void getSources(std::vector<Processor*> &sources) {
+        sources.push_back(portLeft);
+        sources.push_back(portRight);
+    }
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
     void reposition() {}
+    std::string getLabel() { return "Audio.StereoIn"; }
     // AudioSource interface
     unsigned int getAudioOutputCount() { return 2; }
     AudioConnection *getAudioConnection(unsigned int index);
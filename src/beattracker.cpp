@@ -34,18 +34,27 @@ void BeatTracker::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t n
     audio::AudioConnection *connection = audioInput.load();
     float *audio;
     if(connection) {
-        connection->getSource()->process(rolling, pos, nframes, time);
         audio = connection->getAudio();
     } else {
         audio = audio::AudioConnection::getDummyBuffer();
     }
+    bool silent = !connection || connection->isSilent();
+    if(!silent) {
+        hopSilent = false;
+    }
 
     // add new audio to buffer
     for(jack_nframes_t i = 0; i < nframes; i++) {
         btbuffer[index++] = (double) audio[i];
         if(index == BT_HOP_SIZE) {
-            // process buffer if full
-            btrack.processAudioFrame(btbuffer);
+            silentHops = hopSilent ? silentHops + 1 : 0;
+            hopSilent = silent; // rest of this period goes into the next hop
+            // process buffer if full, skip the analysis once it has settled on silence
+            if(silentHops > BT_SILENT_HOPS) {
+                btrack.processOnsetDetectionFunctionSample(0);
+            } else {
+                btrack.processAudioFrame(btbuffer);
+            }
             if(btrack.beatDueInCurrentFrame()) {
                 // set bpm
                 master->forceBeat(btrack.getCurrentTempoEstimate());
@@ -191,7 +200,6 @@ void BeatTracker::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t n
     midi::MidiConnection *connection = midiInput.load();
     uint32_t eventCount = 0;
     if(connection) {
-        connection->getSource()->process(rolling, pos, nframes, time);
         eventCount = connection->getEventCount();
     }        
 
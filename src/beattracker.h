@@ -29,6 +29,8 @@
 namespace bipscript {
 
 const unsigned int BT_HOP_SIZE = 512;
+// two hops fill the analysis frame, two more clear the phase history
+const unsigned int BT_SILENT_HOPS = 4;
 
 namespace audio {
 
@@ -37,22 +39,32 @@ class BeatTracker : public Processor
     BTrack btrack;
     double *btbuffer;
     unsigned int index;
+    bool hopSilent;
+    unsigned int silentHops;
     transport::Master *master;
     std::atomic<audio::AudioConnection *> audioInput;
 public:
     BeatTracker(double bpm, float beatsPerBar, float beatUnit)
-        : index(0), audioInput(0) {
+        : index(0), hopSilent(true), silentHops(0), audioInput(0) {
         btbuffer = new double[BT_HOP_SIZE];
         reset(bpm, beatsPerBar, beatUnit);
     }
     void connect(audio::Source &source) {
-        this->audioInput.store(source.getAudioConnection(0));
+        connect(*source.getAudioConnection(0));
     }
     void connect(audio::AudioConnection &connection) {
         this->audioInput.store(&connection);
+        AudioEngine::instance().graphChanged();
+    }
+    void getSources(std::vector<Processor*> &sources) {
+        audio::AudioConnection *connection = audioInput.load();
+        if(connection) {
+            sources.push_back(connection->getSource());
+        }
     }
     void reset(double bpm, float beatsPerBar, float beatUnit);
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
+    std::string getLabel() { return "Audio.BeatTracker"; }
     void reposition() {}
 };
 
@@ -119,6 +131,13 @@ public:
     }
     void connectMidi(midi::Source &source) {
         this->midiInput.store(source.getMidiConnection(0));
+        AudioEngine::instance().graphChanged();
+    }
+    void getSources(std::vector<Processor*> &sources) {
+        midi::MidiConnection *connection = midiInput.load();
+        if(connection) {
+            sources.push_back(connection->getSource());
+        }
     }
     void setNoteWeight(uint32_t note, float weight);
     void countIn(uint8_t note) { countInNote.store(note); }
@@ -127,6 +146,7 @@ public:
     void stopOnSilence(uint32_t seconds) { stopSeconds.store(seconds); }
     void reset(double bpm, float beatsPerBar, float beatUnit);
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
+    std::string getLabel() { return "Midi.BeatTracker"; }
     void reposition() {}
 private:
     void dispatchCountInEvent(uint32_t count);
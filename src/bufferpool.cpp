@@ -0,0 +1,120 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bufferpool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace bipscript {
+namespace audio {
+
+BufferBlocks::~BufferBlocks()
+{
+    for(void *allocation : allocations) {
+        free(allocation);
+    }
+}
+
+/**
+ * Allocate zeroed, aligned memory that lives as long as these blocks.
+ */
+void *BufferBlocks::allocate(size_t bytes)
+{
+    void *memory = BufferPool::allocate(bytes);
+    allocations.push_back(memory);
+    return memory;
+}
+
+BufferPool::~BufferPool()
+{
+    for(void *buffer : silences) {
+        free(buffer);
+    }
+}
+
+/**
+ * Allocate zeroed, cache line aligned memory.
+ */
+void *BufferPool::allocate(size_t bytes)
+{
+    void *memory;
+    if(posix_memalign(&memory, ALIGNMENT, bytes)) {
+        throw std::bad_alloc();
+    }
+    std::memset(memory, 0, bytes);
+    return memory;
+}
+
+/**
+ * Give the current blocks a new slot table where the slots from the given index on are
+ * carved out of the given chunk.
+ */
+void BufferPool::publish(uint32_t count, float *chunk, uint32_t first)
+{
+    float **fresh = static_cast<float**>(blocks->allocate(count * sizeof(float*)));
+    for(uint32_t i = 0; i < first; i++) {
+        fresh[i] = blocks->table[i];
+    }
+    for(uint32_t i = first; i < count; i++) {
+        fresh[i] = chunk + (i - first) * blocks->stride;
+    }
+    blocks->table = fresh;
+    slotCount = count;
+}
+
+/**
+ * Move the slots to new blocks if they are too small for the given period size. Graphs
+ * built before keep the old blocks until they are reclaimed.
+ *
+ * Runs in the script thread, or in the main thread before the script starts.
+ *
+ * Allocates slot memory.
+ */
+void BufferPool::setBufferSize(jack_nframes_t size)
+{
+    // round up to whole cache lines
+    size_t floats = (size * sizeof(float) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT / sizeof(float);
+    if(blocks && floats <= blocks->stride) {
+        return;
+    }
+    float *zeroes = static_cast<float*>(allocate(floats * sizeof(float)));
+    silences.push_back(zeroes);
+    silence.store(zeroes, std::memory_order_release);
+    blocks.reset(new BufferBlocks(size, floats));
+    if(slotCount) {
+        publish(slotCount, static_cast<float*>(blocks->allocate(slotCount * floats * sizeof(float))), 0);
+    }
+}
+
+/**
+ * Make sure there are at least the given number of slots, returns the blocks holding them.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates slot memory.
+ */
+std::shared_ptr<BufferBlocks> BufferPool::reserve(uint32_t count)
+{
+    if(count > slotCount) {
+        publish(count, static_cast<float*>(blocks->allocate((count - slotCount) * blocks->stride * sizeof(float))), slotCount);
+    }
+    return blocks;
+}
+
+}}
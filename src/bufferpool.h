@@ -0,0 +1,93 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <jack/types.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace bipscript {
+namespace audio {
+
+/**
+ * Slot memory for one buffer size. Every process graph holds the blocks its slots point into,
+ * so blocks replaced after a buffer size increase are freed along with the last graph using
+ * them.
+ */
+class BufferBlocks
+{
+    std::vector<void*> allocations;
+public:
+    const jack_nframes_t frames;
+    const size_t stride; // floats per slot
+    float **table; // latest slot table, older tables stay valid
+    BufferBlocks(jack_nframes_t frames, size_t stride) : frames(frames), stride(stride), table(0) {}
+    ~BufferBlocks();
+    void *allocate(size_t bytes);
+};
+
+/**
+ * Cache line aligned audio buffers that connections share according to their liveness in
+ * the process schedule.
+ *
+ * Only the script thread resizes the pool, the process thread reaches slots through the
+ * graph it has installed.
+ */
+class BufferPool
+{
+    static const size_t ALIGNMENT = 64;
+    std::shared_ptr<BufferBlocks> blocks;
+    uint32_t slotCount;
+    std::atomic<float*> silence;
+    std::vector<void*> silences; // the process thread may read an older one until its period ends
+    // usage of the latest graph
+    std::atomic<uint32_t> connectionCount;
+    std::atomic<uint32_t> usedSlots;
+    void publish(uint32_t count, float *chunk, uint32_t first);
+    // singleton
+    BufferPool() : slotCount(0), silence(0), connectionCount(0), usedSlots(0) {}
+    BufferPool(BufferPool const&);
+    void operator=(BufferPool const&);
+public:
+    static void *allocate(size_t bytes);
+    static BufferPool &instance() {
+        static BufferPool instance;
+        return instance;
+    }
+    ~BufferPool();
+    void setBufferSize(jack_nframes_t size);
+    std::shared_ptr<BufferBlocks> reserve(uint32_t count);
+    void setUsage(uint32_t connections, uint32_t slots) {
+        connectionCount.store(connections);
+        usedSlots.store(slots);
+    }
+    /**
+     * Zeroed buffer of the largest period size so far, for inputs that are not connected.
+     */
+    float *getSilence() {
+        return silence.load(std::memory_order_acquire);
+    }
+    long getBytesSaved() {
+        return blocks ? (long)(connectionCount.load() - usedSlots.load()) * blocks->stride * sizeof(float) : 0;
+    }
+};
+
+}}
+
+#endif // BUFFERPOOL_H
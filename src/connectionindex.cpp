@@ -0,0 +1,185 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "connectionindex.h"
+
+#include <algorithm>
+
+namespace bipscript {
+
+ConnectionIndex::Node &ConnectionIndex::getNode(AbstractSource *source)
+{
+    auto found = nodes.find(source);
+    if(found != nodes.end()) {
+        return found->second;
+    }
+    Node &node = nodes[source];
+    node.order = nextOrder++;
+    return node;
+}
+
+/**
+ * Record a connection from one source into another, returns false without recording it if
+ * the connection would close a loop.
+ *
+ * Runs in the script thread.
+ */
+bool ConnectionIndex::connect(AbstractSource *from, AbstractSource *to)
+{
+    if(from == to) {
+        return false;
+    }
+    Node &fromNode = getNode(from);
+    Node &toNode = getNode(to);
+    // already in order, nothing downstream of to can reach from
+    if(fromNode.order < toNode.order) {
+        fromNode.downstream[to]++;
+        toNode.upstream[from]++;
+        return true;
+    }
+    // search the sources ordered between the two ends
+    uint32_t upperBound = fromNode.order;
+    uint32_t lowerBound = toNode.order;
+    forwardVisited.clear();
+    backwardVisited.clear();
+    marked.clear();
+    if(searchForward(to, from, upperBound)) {
+        return false;
+    }
+    searchBackward(from, lowerBound);
+    reorder();
+    fromNode.downstream[to]++;
+    toNode.upstream[from]++;
+    return true;
+}
+
+/**
+ * Forget one connection from one source into another.
+ *
+ * Runs in the script thread.
+ */
+void ConnectionIndex::disconnect(AbstractSource *from, AbstractSource *to)
+{
+    auto fromNode = nodes.find(from);
+    auto toNode = nodes.find(to);
+    if(fromNode == nodes.end() || toNode == nodes.end()) {
+        return;
+    }
+    auto downstream = fromNode->second.downstream.find(to);
+    if(downstream != fromNode->second.downstream.end() && !--downstream->second) {
+        fromNode->second.downstream.erase(downstream);
+    }
+    auto upstream = toNode->second.upstream.find(from);
+    if(upstream != toNode->second.upstream.end() && !--upstream->second) {
+        toNode->second.upstream.erase(upstream);
+    }
+}
+
+/**
+ * Forget a deleted source and all its connections.
+ *
+ * Runs in the script thread.
+ */
+void ConnectionIndex::forget(AbstractSource *source)
+{
+    auto found = nodes.find(source);
+    if(found == nodes.end()) {
+        return;
+    }
+    for(auto &downstream : found->second.downstream) {
+        nodes[downstream.first].upstream.erase(source);
+    }
+    for(auto &upstream : found->second.upstream) {
+        nodes[upstream.first].downstream.erase(source);
+    }
+    nodes.erase(found);
+}
+
+/**
+ * Collect the sources downstream of start ordered up to the bound, returns true if the
+ * target is among them.
+ */
+bool ConnectionIndex::searchForward(AbstractSource *start, AbstractSource *target, uint32_t upperBound)
+{
+    std::vector<AbstractSource*> stack(1, start);
+    marked[start] = true;
+    while(!stack.empty()) {
+        AbstractSource *source = stack.back();
+        stack.pop_back();
+        forwardVisited.push_back(source);
+        for(auto &downstream : nodes[source].downstream) {
+            AbstractSource *next = downstream.first;
+            if(next == target) {
+                return true;
+            }
+            if(nodes[next].order < upperBound && !marked[next]) {
+                marked[next] = true;
+                stack.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Collect the sources upstream of start ordered down to the bound.
+ */
+void ConnectionIndex::searchBackward(AbstractSource *start, uint32_t lowerBound)
+{
+    std::vector<AbstractSource*> stack(1, start);
+    marked[start] = true;
+    while(!stack.empty()) {
+        AbstractSource *source = stack.back();
+        stack.pop_back();
+        backwardVisited.push_back(source);
+        for(auto &upstream : nodes[source].upstream) {
+            AbstractSource *next = upstream.first;
+            if(nodes[next].order > lowerBound && !marked[next]) {
+                marked[next] = true;
+                stack.push_back(next);
+            }
+        }
+    }
+}
+
+/**
+ * Give the visited sources the same set of positions, upstream ones first.
+ */
+void ConnectionIndex::reorder()
+{
+    auto byOrder = [this](AbstractSource *a, AbstractSource *b) {
+        return nodes[a].order < nodes[b].order;
+    };
+    std::sort(forwardVisited.begin(), forwardVisited.end(), byOrder);
+    std::sort(backwardVisited.begin(), backwardVisited.end(), byOrder);
+    std::vector<uint32_t> positions;
+    for(AbstractSource *source : backwardVisited) {
+        positions.push_back(nodes[source].order);
+    }
+    for(AbstractSource *source : forwardVisited) {
+        positions.push_back(nodes[source].order);
+    }
+    std::sort(positions.begin(), positions.end());
+    uint32_t position = 0;
+    for(AbstractSource *source : backwardVisited) {
+        nodes[source].order = positions[position++];
+    }
+    for(AbstractSource *source : forwardVisited) {
+        nodes[source].order = positions[position++];
+    }
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONNECTIONINDEX_H
+#define CONNECTIONINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace bipscript {
+
+class AbstractSource;
+
+/**
+ * Topological order of the sources kept up to date as connections are made (Pearce-Kelly),
+ * so a new connection only has to search the part of the graph between its two ends to rule
+ * out a loop.
+ *
+ * Runs in the script thread.
+ */
+class ConnectionIndex
+{
+    struct Node {
+        uint32_t order;
+        // connection counts to and from neighbouring sources
+        std::unordered_map<AbstractSource*, uint32_t> downstream;
+        std::unordered_map<AbstractSource*, uint32_t> upstream;
+    };
+    std::unordered_map<AbstractSource*, Node> nodes;
+    uint32_t nextOrder;
+    std::vector<AbstractSource*> forwardVisited;
+    std::vector<AbstractSource*> backwardVisited;
+    std::unordered_map<AbstractSource*, bool> marked;
+    ConnectionIndex() : nextOrder(0) {}
+    Node &getNode(AbstractSource *source);
+    bool searchForward(AbstractSource *start, AbstractSource *target, uint32_t upperBound);
+    void searchBackward(AbstractSource *start, uint32_t lowerBound);
+    void reorder();
+public:
+    static ConnectionIndex &instance() {
+        static ConnectionIndex instance;
+        return instance;
+    }
+    bool connect(AbstractSource *from, AbstractSource *to);
+    void disconnect(AbstractSource *from, AbstractSource *to);
+    void forget(AbstractSource *source);
+};
+
+}
+
+#endif // CONNECTIONINDEX_H
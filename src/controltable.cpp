@@ -0,0 +1,71 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "controltable.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace bipscript {
+
+ControlCurve ControlCurve::linear(float minimum, float maximum)
+{
+    ControlCurve curve;
+    for(int i = 0; i < 128; i++) {
+        curve.values[i] = minimum + (maximum - minimum) * i / 127;
+    }
+    return curve;
+}
+
+/**
+ * Equal ratios for equal controller steps, for frequencies and gains.
+ */
+ControlCurve ControlCurve::logarithmic(float minimum, float maximum)
+{
+    if(minimum <= 0 || maximum <= 0) {
+        throw std::logic_error("logarithmic control curve needs a minimum and maximum above zero");
+    }
+    ControlCurve curve;
+    for(int i = 0; i < 128; i++) {
+        curve.values[i] = minimum * std::pow(maximum / minimum, i / 127.0f);
+    }
+    return curve;
+}
+
+/**
+ * Points spread evenly over the controller range with straight lines in between.
+ */
+ControlCurve ControlCurve::table(const std::vector<float> &points)
+{
+    if(points.size() < 2 || points.size() > 128) {
+        throw std::logic_error("control table should have between 2 and 128 values");
+    }
+    ControlCurve curve;
+    uint32_t segments = points.size() - 1;
+    for(int i = 0; i < 128; i++) {
+        float position = (float)i * segments / 127;
+        uint32_t index = position;
+        if(index >= segments) {
+            curve.values[i] = points.back();
+        } else {
+            float fraction = position - index;
+            curve.values[i] = points[index] + (points[index + 1] - points[index]) * fraction;
+        }
+    }
+    return curve;
+}
+
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONTROLTABLE_H
+#define CONTROLTABLE_H
+
+#include "listable.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace bipscript {
+
+/**
+ * Value for each of the 128 values of a MIDI controller.
+ *
+ * Built in the script thread.
+ */
+struct ControlCurve
+{
+    float values[128];
+    static ControlCurve linear(float minimum, float maximum);
+    static ControlCurve logarithmic(float minimum, float maximum);
+    static ControlCurve table(const std::vector<float> &points);
+};
+
+/**
+ * Targets of the controllers of one MIDI connection indexed by channel and controller
+ * number, each controller can drive any number of targets.
+ *
+ * Built in the script thread, read by the process thread.
+ */
+template <class T>
+class ControlTable : public Listable
+{
+public:
+    struct Mapping {
+        int channel; // -1 for all channels
+        uint8_t cc;
+        T target;
+        ControlCurve curve;
+    };
+    struct Dispatch {
+        T target;
+        const float *values;
+    };
+private:
+    struct Span {
+        uint32_t first;
+        uint32_t count;
+    };
+    Span spans[16][128];
+    std::vector<Dispatch> dispatches;
+    std::vector<ControlCurve> curves;
+public:
+    ControlTable(const std::vector<Mapping> &mappings);
+    /**
+     * First target of a controller, the span of targets ends at end().
+     *
+     * Runs in the process thread.
+     */
+    const Dispatch *begin(uint8_t channel, uint8_t cc) {
+        return dispatches.data() + spans[channel & 0x0f][cc & 0x7f].first;
+    }
+    const Dispatch *end(uint8_t channel, uint8_t cc) {
+        const Span &span = spans[channel & 0x0f][cc & 0x7f];
+        return dispatches.data() + span.first + span.count;
+    }
+};
+
+/**
+ * Sort the mappings into one span per channel and controller.
+ *
+ * Runs in the script thread.
+ */
+template <class T>
+ControlTable<T>::ControlTable(const std::vector<Mapping> &mappings)
+{
+    // count the targets of each controller
+    for(int channel = 0; channel < 16; channel++) {
+        for(int cc = 0; cc < 128; cc++) {
+            spans[channel][cc].first = 0;
+            spans[channel][cc].count = 0;
+        }
+    }
+    for(const Mapping &mapping : mappings) {
+        for(int channel = 0; channel < 16; channel++) {
+            if(mapping.channel < 0 || mapping.channel == channel) {
+                spans[channel][mapping.cc & 0x7f].count++;
+            }
+        }
+    }
+    uint32_t total = 0;
+    for(int channel = 0; channel < 16; channel++) {
+        for(int cc = 0; cc < 128; cc++) {
+            spans[channel][cc].first = total;
+            total += spans[channel][cc].count;
+            spans[channel][cc].count = 0;
+        }
+    }
+    // fill in the spans, curves are shared by the channels of a mapping
+    curves.reserve(mappings.size());
+    dispatches.resize(total);
+    for(const Mapping &mapping : mappings) {
+        curves.push_back(mapping.curve);
+        for(int channel = 0; channel < 16; channel++) {
+            if(mapping.channel < 0 || mapping.channel == channel) {
+                Span &span = spans[channel][mapping.cc & 0x7f];
+                Dispatch &dispatch = dispatches[span.first + span.count++];
+                dispatch.target = mapping.target;
+                dispatch.values = curves.back().values;
+            }
+        }
+    }
+}
+
+}
+
+#endif // CONTROLTABLE_H
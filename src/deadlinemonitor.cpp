@@ -0,0 +1,52 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "deadlinemonitor.h"
+
+namespace bipscript {
+
+/**
+ * Write the callback histogram as percentage of the period and the recent xruns.
+ *
+ * Runs in the script thread.
+ */
+void DeadlineMonitor::dump(std::ostream &out)
+{
+    uint64_t count = callbacks.load();
+    uint32_t xrunCount = xruns.load();
+    out << "deadlines: " << count << " callbacks, " << overruns.load() << " over the period, max "
+        << maximum.load() * 100.0 / FULL_PERIOD << "% of the period, " << xrunCount << " xruns" << std::endl;
+    double lower = 0;
+    for(uint32_t i = 0; i < LogHistogram::BUCKETS; i++) {
+        double upper = LogHistogram::bucketLimit(i) * 100.0 / FULL_PERIOD;
+        uint32_t bucketCount = histogram.get(i);
+        if(bucketCount) {
+            out << "  " << lower << "% - " << upper << "%: " << bucketCount << std::endl;
+        }
+        lower = upper;
+    }
+    if(xrunCount) {
+        out << "  xruns at bar";
+        uint32_t logged = xrunCount < XRUN_LOG ? xrunCount : XRUN_LOG;
+        for(uint32_t i = xrunCount - logged; i < xrunCount; i++) {
+            out << " " << xrunBars[i % XRUN_LOG].load();
+        }
+        out << std::endl;
+    }
+}
+
+}
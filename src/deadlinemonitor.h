@@ -0,0 +1,94 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DEADLINEMONITOR_H
+#define DEADLINEMONITOR_H
+
+#include "processorload.h"
+
+#include <jack/types.h>
+#include <atomic>
+#include <ostream>
+
+namespace bipscript {
+
+/**
+ * Records how much of its period each process callback uses, and the xruns reported by the
+ * driver with the bar they happened at.
+ *
+ * Written lock free from the process thread and the driver notification thread, read from the
+ * script thread.
+ */
+class DeadlineMonitor
+{
+    static const uint32_t FULL_PERIOD = 1024; // callback time unit
+    static const uint32_t XRUN_LOG = 32;
+    std::atomic<uint64_t> callbacks;
+    std::atomic<uint64_t> overruns;
+    std::atomic<uint32_t> maximum;
+    LogHistogram histogram;
+    std::atomic<int32_t> currentBar;
+    std::atomic<uint32_t> xruns;
+    std::atomic<int32_t> xrunBars[XRUN_LOG];
+    std::atomic<bool> dumpRequested;
+public:
+    DeadlineMonitor() : callbacks(0), overruns(0), maximum(0), currentBar(0), xruns(0),
+        dumpRequested(false) {}
+    /**
+     * Add one callback that took the given time for a period of nframes.
+     *
+     * Runs in the process thread.
+     */
+    void record(uint64_t elapsed, jack_nframes_t nframes, jack_nframes_t sampleRate, int32_t bar) {
+        uint64_t periodLength = 1000000000ull * nframes / sampleRate;
+        uint64_t used = periodLength ? elapsed * FULL_PERIOD / periodLength : 0;
+        uint32_t load = used > UINT32_MAX ? UINT32_MAX : used;
+        callbacks.fetch_add(1, std::memory_order_relaxed);
+        if(load >= FULL_PERIOD) {
+            overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        if(load > maximum.load(std::memory_order_relaxed)) {
+            maximum.store(load, std::memory_order_relaxed);
+        }
+        histogram.add(load);
+        currentBar.store(bar, std::memory_order_relaxed);
+    }
+    /**
+     * Count an xrun reported by the driver.
+     *
+     * Runs in the driver notification thread.
+     */
+    void xrun() {
+        uint32_t index = xruns.fetch_add(1);
+        xrunBars[index % XRUN_LOG].store(currentBar.load(std::memory_order_relaxed));
+    }
+    /**
+     * Ask for a report at the next script thread flush, safe to call from a signal handler.
+     */
+    void requestDump() {
+        dumpRequested.store(true);
+    }
+    void dumpIfRequested(std::ostream &out) {
+        if(dumpRequested.exchange(false)) {
+            dump(out);
+        }
+    }
+    void dump(std::ostream &out);
+};
+
+}
+
+#endif // DEADLINEMONITOR_H
@@ -0,0 +1,78 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DELAYLINE_H
+#define DELAYLINE_H
+
+#include <jack/types.h>
+#include <cstdint>
+
+namespace bipscript {
+namespace audio {
+
+/**
+ * Fixed delay for one audio input, lines up inputs that reach a processor through paths of
+ * different latency.
+ *
+ * Allocated in the script thread, processed in the process thread.
+ */
+class DelayLine
+{
+    jack_nframes_t delay;
+    jack_nframes_t maxFrames;
+    uint32_t mask;
+    uint32_t writeIndex;
+    float *ring;
+    float *output;
+public:
+    DelayLine(jack_nframes_t delay, jack_nframes_t maxFrames)
+        : delay(delay), maxFrames(maxFrames), writeIndex(0) {
+        uint32_t size = 1;
+        while(size < delay + maxFrames) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        ring = new float[size]();
+        output = new float[maxFrames]();
+    }
+    ~DelayLine() {
+        delete[] ring;
+        delete[] output;
+    }
+    jack_nframes_t getDelay() { return delay; }
+    jack_nframes_t getMaxFrames() { return maxFrames; }
+    /**
+     * Add a period of input and return the same period delayed, periods longer than the line
+     * was made for pass undelayed until the graph is rebuilt.
+     *
+     * Runs in the process thread.
+     */
+    float *process(float *input, jack_nframes_t nframes) {
+        if(nframes > maxFrames) {
+            return input;
+        }
+        for(jack_nframes_t i = 0; i < nframes; i++) {
+            ring[(writeIndex + i) & mask] = input[i];
+            output[i] = ring[(writeIndex + i - delay) & mask];
+        }
+        writeIndex += nframes;
+        return output;
+    }
+};
+
+}}
+
+#endif // DELAYLINE_H
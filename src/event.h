@@ -29,11 +29,25 @@ class Event : public Position, public Listable
 //    static int refCount; // debugging
 //    static std::set<Event*> refSet;
     long frameOffset;
+    uint32_t generation; // script run that created this event
+    bool timeline; // kept in the timeline of its buffer after being played
 public:
-    Event(Position &pos) : Position(pos) {} // refCount++; refSet.insert(this); }
-    Event(const Event &other) : Position(other) {}
+    Event(Position &pos) : Position(pos), generation(0), timeline(false) {} // refCount++; refSet.insert(this); }
+    Event(const Event &other) : Position(other), generation(other.generation), timeline(false) {}
     Event(unsigned int bar, unsigned int position, unsigned int division) :
-        Position(bar, position, division) {} // refCount++; refSet.insert(this); }
+        Position(bar, position, division), generation(0), timeline(false) {} // refCount++; refSet.insert(this); }
+    bool onTimeline() const {
+        return timeline;
+    }
+    void setOnTimeline() {
+        this->timeline = true;
+    }
+    uint32_t getGeneration() const {
+        return generation;
+    }
+    void setGeneration(uint32_t generation) {
+        this->generation = generation;
+    }
     long getFrameOffset() const {
         return this->frameOffset;
     }
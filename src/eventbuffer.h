@@ -19,40 +19,234 @@
 
 #include "eventlist.h"
 #include "objectcollector.h"
+#include "scriptgeneration.h"
+#include "timeline.h"
 
 #include <jack/types.h>
 #include <boost/lockfree/spsc_queue.hpp>
+#include <algorithm>
+#include <vector>
 
 #define UPDATE_MAX_EVENTS 32
 
 namespace bipscript {
 
-template <class T> class EventBuffer
+template <class T> class EventBuffer : public TimelineOwner
 {
     boost::lockfree::spsc_queue<T*> eventQueue; // script thread -> process thread
     EventList<T> sortedEvents; // local to process thread
+    EventList<T> stagedEvents; // later generations, local to process thread
+    uint32_t generation; // local to process thread
+    // timeline, owned by the script thread
+    std::vector<T*> timeline;
+    std::vector<TimelineSnapshot<T>*> snapshots;
+    std::vector<std::pair<uint32_t, T*>> retired; // unreachable once this serial is installed
+    uint32_t serial;
+    std::atomic<TimelineSnapshot<T>*> pendingSnapshot; // script thread -> process thread
+    std::atomic<uint32_t> installedSerial; // process thread -> script thread
+    // timeline cursor, local to process thread
+    TimelineSnapshot<T> *currentSnapshot;
+    uint32_t cursor;
+    jack_nframes_t periodFrame;
+    bool seekNeeded;
+    void swapGeneration(uint32_t playing);
+    void installTimeline();
+    void seek(jack_position_t &pos);
 public:
-    EventBuffer() : eventQueue(2048) {}
+    EventBuffer() : eventQueue(2048), generation(0), serial(0), pendingSnapshot(0),
+        installedSerial(0), currentSnapshot(0), cursor(0), periodFrame(0), seekNeeded(false) {}
+    ~EventBuffer();
     void addEvent(T* evt);
     void update();
     T *getNextEvent(bool rolling, jack_position_t &pos, jack_nframes_t nframes);
+    /**
+     * Hand back an event returned by getNextEvent once it has been used.
+     *
+     * Runs in the process thread.
+     */
+    void release(T *evt) {
+        if(!evt->onTimeline()) {
+            ObjectCollector::scriptCollector().recycle(evt);
+        }
+    }
+    /**
+     * Find the timeline cursor again at the start of the next period.
+     */
+    void seekNextPeriod() {
+        seekNeeded = true;
+    }
+    void relocate();
     void recycleRemaining();
+    // TimelineOwner interface
+    void publishTimeline();
+    void clearTimeline();
 };
 
-// runs in script thread
+// runs in script thread, after the process thread can no longer reach this buffer
+template <class T>
+EventBuffer<T>::~EventBuffer()
+{
+    EventTimelines::instance().forget(this);
+    for(TimelineSnapshot<T> *snapshot : snapshots) {
+        delete snapshot;
+    }
+    for(T *evt : timeline) {
+        delete evt;
+    }
+    for(auto &entry : retired) {
+        delete entry.second;
+    }
+}
+
+// runs in script thread, or the process thread for routed events
 template <class T>
 void EventBuffer<T>::addEvent(T *evt)  {
+    evt->setGeneration(ScriptGeneration::instance().forEvent());
+    // events scheduled by the main run go on the timeline, published at the next flush
+    if(ScriptGeneration::inMainRun() && evt->getBar() && EventTimelines::instance().isEnabled()) {
+        evt->setOnTimeline();
+        auto at = std::upper_bound(timeline.begin(), timeline.end(), evt,
+                                   [](T *a, T *b) { return *a < *b; });
+        timeline.insert(at, evt);
+        EventTimelines::instance().markChanged(this);
+        return;
+    }
     while(!eventQueue.push(evt)); // maybe wait a bit?
 }
 
+// script thread: hand a sorted copy of the timeline to the process thread
+template <class T>
+void EventBuffer<T>::publishTimeline()
+{
+    // reclaim snapshots and events the process thread has moved past
+    uint32_t installed = installedSerial.load(std::memory_order_acquire);
+    for(auto it = snapshots.begin(); it != snapshots.end();) {
+        if((*it)->serial < installed) {
+            delete *it;
+            it = snapshots.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for(auto it = retired.begin(); it != retired.end();) {
+        if(it->first <= installed) {
+            delete it->second;
+            it = retired.erase(it);
+        } else {
+            it++;
+        }
+    }
+    TimelineSnapshot<T> *snapshot = new TimelineSnapshot<T>(++serial, timeline.size());
+    std::copy(timeline.begin(), timeline.end(), snapshot->events);
+    snapshots.push_back(snapshot);
+    TimelineSnapshot<T> *replaced = pendingSnapshot.exchange(snapshot);
+    if(replaced) {
+        // never installed
+        snapshots.erase(std::find(snapshots.begin(), snapshots.end(), replaced));
+        delete replaced;
+    }
+}
+
+// script thread: the events stay valid until the next snapshot has been installed
+template <class T>
+void EventBuffer<T>::clearTimeline()
+{
+    for(T *evt : timeline) {
+        retired.push_back(std::make_pair(serial + 1, evt));
+    }
+    timeline.clear();
+}
+
+// process thread
+template <class T>
+void EventBuffer<T>::installTimeline()
+{
+    TimelineSnapshot<T> *snapshot = pendingSnapshot.exchange(0, std::memory_order_acq_rel);
+    if(snapshot) {
+        currentSnapshot = snapshot;
+        installedSerial.store(snapshot->serial, std::memory_order_release);
+        seekNeeded = true;
+    }
+}
+
+// process thread: binary search for the first event not yet due at the given position
+template <class T>
+void EventBuffer<T>::seek(jack_position_t &pos)
+{
+    uint32_t low = 0, high = currentSnapshot ? currentSnapshot->size : 0;
+    while(low < high) {
+        uint32_t middle = (low + high) / 2;
+        if(currentSnapshot->events[middle]->calculateFrameOffset(pos) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    cursor = low;
+    seekNeeded = false;
+}
+
+/**
+ * Move the timeline cursor to the transport position of the next period and drop events
+ * that were not scheduled by the main run, their handlers schedule them again.
+ *
+ * Runs in the process thread.
+ */
+template <class T>
+void EventBuffer<T>::relocate()
+{
+    seekNextPeriod();
+    if(sortedEvents.getFirst()) {
+        ObjectCollector::scriptCollector().recycleAll(sortedEvents);
+    }
+    sortedEvents.clear();
+}
+
+// process thread: drop the events of the previous run and activate the staged ones
+template <class T>
+void EventBuffer<T>::swapGeneration(uint32_t playing)
+{
+    ObjectCollector &collector = ObjectCollector::scriptCollector();
+    if(sortedEvents.getFirst()) {
+        collector.recycleAll(sortedEvents);
+    }
+    sortedEvents.clear();
+    EventList<T> later;
+    T *evt = stagedEvents.getFirst();
+    while(evt) {
+        T *next = stagedEvents.getNext(evt);
+        evt->next = 0;
+        if(evt->getGeneration() < playing) {
+            collector.recycle(evt);
+        } else if(evt->getGeneration() == playing) {
+            sortedEvents.insert(evt);
+        } else {
+            later.insert(evt);
+        }
+        evt = next;
+    }
+    stagedEvents = later;
+    generation = playing;
+}
+
 // process thread
 template <class T>
 void EventBuffer<T>::update()
 {
+    uint32_t playing = ScriptGeneration::instance().getPlaying();
+    if(playing != generation) {
+        swapGeneration(playing);
+    }
     T *freshEvent;
     int counter = 0;
     while (counter < UPDATE_MAX_EVENTS && eventQueue.pop(freshEvent)) {
-        sortedEvents.insert(freshEvent);
+        if(freshEvent->getGeneration() == generation) {
+            sortedEvents.insert(freshEvent);
+        } else if(freshEvent->getGeneration() > generation) {
+            stagedEvents.insert(freshEvent); // held until the swap
+        } else {
+            ObjectCollector::scriptCollector().recycle(freshEvent);
+        }
         counter++;
     }
 }
@@ -62,6 +256,14 @@ template <class T>
 T *EventBuffer<T>::getNextEvent(bool rolling, jack_position_t &pos, jack_nframes_t nframes)
 {
     update();
+    // timeline changes apply at the start of a period, before any of its events are played
+    if(!rolling || pos.frame != periodFrame) {
+        periodFrame = pos.frame;
+        installTimeline();
+        if(seekNeeded) {
+            seek(pos);
+        }
+    }
     T *first = sortedEvents.getFirst();
     // pass thru zero bar events
     if(first && !first->getBar()) {
@@ -75,8 +277,23 @@ T *EventBuffer<T>::getNextEvent(bool rolling, jack_position_t &pos, jack_nframes
             first = sortedEvents.pop();
             ObjectCollector::scriptCollector().recycle(late);
         }
-        // return the top event if it fits in this buffer
-        if(first && first->getFrameOffset() < nframes) {
+        // skip timeline events that have already passed
+        T *scheduled = 0;
+        while(currentSnapshot && cursor < currentSnapshot->size) {
+            scheduled = currentSnapshot->events[cursor];
+            if(scheduled->updateFrameOffset(pos) >= -256) {
+                break;
+            }
+            scheduled = 0;
+            cursor++;
+        }
+        // return the earlier of the two if it fits in this buffer
+        if(scheduled && (!first || scheduled->getFrameOffset() < first->getFrameOffset())) {
+            if(scheduled->getFrameOffset() < nframes) {
+                cursor++;
+                return scheduled;
+            }
+        } else if(first && first->getFrameOffset() < nframes) {
             sortedEvents.pop();
             return first;
         }
@@ -95,8 +312,16 @@ void EventBuffer<T>::recycleRemaining()
         collector.recycle(nextEvent);
     }
     // clear existing events
-    collector.recycleAll(sortedEvents);
+    if(sortedEvents.getFirst()) {
+        collector.recycleAll(sortedEvents);
+    }
     sortedEvents.clear();
+    if(stagedEvents.getFirst()) {
+        collector.recycleAll(stagedEvents);
+    }
+    stagedEvents.clear();
+    // drop the snapshot, the rerun publishes a new timeline
+    currentSnapshot = 0;
 }
 
 }
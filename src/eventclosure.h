@@ -34,10 +34,10 @@ public:
   EventClosure(ScriptFunction &function) :
       ScriptFunctionClosure(function) {}
   void* operator new(size_t size) {
-    return MemoryPool::processPool().malloc(size);
+    return MemoryPool::currentPool().malloc(size);
   }
   void operator delete(void *p) {
-    MemoryPool::processPool().free(p);
+    MemoryPool::owner(p).free(p);
   }
   void recycle() {
     ObjectCollector::processCollector().recycle(this);
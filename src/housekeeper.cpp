@@ -0,0 +1,82 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "housekeeper.h"
+#include "objectcollector.h"
+
+#include <chrono>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace bipscript {
+
+void *run_housekeeper(void *arg)
+{
+    ((Housekeeper*)arg)->run();
+    return 0;
+}
+
+/**
+ * Start the thread as a batch thread so it does not preempt the script thread, it stays at
+ * normal priority where batch scheduling is not allowed.
+ *
+ * Runs in the main thread.
+ */
+void Housekeeper::start()
+{
+    if(started.exchange(true)) {
+        return;
+    }
+    if(pthread_create(&thread, 0, run_housekeeper, this)) {
+        started.store(false);
+        throw std::logic_error("could not create housekeeping thread");
+    }
+    // thread attributes only take the realtime policies
+    sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(thread, SCHED_BATCH, &param);
+}
+
+/**
+ * Stop the thread after a last collection.
+ *
+ * Runs in the main thread.
+ */
+void Housekeeper::stop()
+{
+    if(!started.exchange(false)) {
+        return;
+    }
+    cancelled.store(true);
+    pthread_join(thread, 0);
+}
+
+void Housekeeper::run()
+{
+    // lower the share of this thread only, a nice value is per thread on Linux
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), HOUSEKEEPER_NICE);
+    while(!cancelled.load()) {
+        ObjectCollector::scriptCollector().free();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ObjectCollector::scriptCollector().free();
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOUSEKEEPER_H
+#define HOUSEKEEPER_H
+
+#include <pthread.h>
+#include <atomic>
+
+namespace bipscript {
+
+/**
+ * Low priority thread that deletes the objects handed off by the process thread, so neither
+ * the process thread nor a busy script thread runs their destructors.
+ */
+class Housekeeper
+{
+    static const int HOUSEKEEPER_NICE = 10;
+    pthread_t thread;
+    std::atomic<bool> started;
+    std::atomic<bool> cancelled;
+    Housekeeper() : started(false), cancelled(false) {}
+    Housekeeper(Housekeeper const&);
+    void operator=(Housekeeper const&);
+public:
+    static Housekeeper &instance() {
+        static Housekeeper instance;
+        return instance;
+    }
+    void start();
+    void stop();
+    void run();
+};
+
+}
+
+#endif // HOUSEKEEPER_H
@@ -0,0 +1,203 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jackdriver.h"
+#include "audioengine.h"
+#include "transportmaster.h"
+
+#include <algorithm>
+
+namespace bipscript {
+
+int jack_process(jack_nframes_t nframes, void *)
+{
+    return AudioEngine::instance().process(nframes);
+}
+
+int sync_callback(jack_transport_state_t state, jack_position_t *pos, void *)
+{
+    return AudioEngine::instance().sync(state, pos);
+}
+
+int buffersize_callback(jack_nframes_t nframes, void *)
+{
+    AudioEngine::instance().setBufferSize(nframes);
+    return 0;
+}
+
+int xrun_callback(void *)
+{
+    AudioEngine::instance().xrun();
+    return 0;
+}
+
+void latency_callback(jack_latency_callback_mode_t mode, void *arg)
+{
+    ((JackDriver*)arg)->reportLatency(mode);
+}
+
+void timebase_callback(jack_transport_state_t state, jack_nframes_t nframes,
+     jack_position_t *pos, int new_pos, void *arg)
+{
+    ((transport::Master*)arg)->setTime(state, nframes, pos, new_pos);
+}
+
+int JackDriver::activate(const char *clientName)
+{
+    // connect to Jack
+    if ((client = jack_client_open(clientName, JackNullOption, NULL)) == 0) {
+        return 1;
+    }
+
+    // Jack callbacks
+    jack_set_process_callback(client, jack_process, this);
+    jack_set_sync_callback(client, sync_callback, this);
+    jack_set_buffer_size_callback(client, &buffersize_callback, this);
+    jack_set_xrun_callback(client, &xrun_callback, this);
+    jack_set_latency_callback(client, &latency_callback, this);
+
+    // get sample rate and buffer size
+    AudioEngine::instance().setSampleRate(jack_get_sample_rate(client));
+    AudioEngine::instance().setBufferSize(jack_get_buffer_size(client));
+
+    // start process workers at the priority of the process thread
+    AudioEngine::instance().startWorkers();
+
+    // activate jack
+    if (jack_activate(client)) {
+        return 1;
+    }
+
+    return 0;
+}
+
+void JackDriver::shutdown()
+{
+    jack_deactivate(client);
+    jack_client_close(client);
+}
+
+bool JackDriver::setTimebaseMaster(transport::Master *master)
+{
+    return !jack_set_timebase_callback(client, 0, &timebase_callback, master);
+}
+
+DriverPort *JackDriver::registerPort(const char *name, DriverPort::Type type)
+{
+    bool midi = type == DriverPort::MIDI_INPUT || type == DriverPort::MIDI_OUTPUT;
+    bool input = type == DriverPort::AUDIO_INPUT || type == DriverPort::MIDI_INPUT;
+    jack_port_t *port = jack_port_register(client, name,
+                                           midi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE,
+                                           input ? JackPortIsInput : JackPortIsOutput, 0);
+    if(!port) {
+        return 0;
+    }
+    JackPort *jackPort = new JackPort(port, input);
+    std::lock_guard<std::mutex> lock(portsMutex);
+    ports.insert(jackPort);
+    return jackPort;
+}
+
+void JackDriver::unregisterPort(DriverPort *port)
+{
+    {
+        std::lock_guard<std::mutex> lock(portsMutex);
+        ports.erase(static_cast<JackPort*>(port));
+    }
+    jack_port_unregister(client, static_cast<JackPort*>(port)->getJackPort());
+    delete port;
+}
+
+/**
+ * Ask the server to recompute latencies, it calls back into reportLatency.
+ *
+ * Runs in the script thread.
+ */
+void JackDriver::latencyChanged()
+{
+    if(client) {
+        jack_recompute_total_latencies(client);
+    }
+}
+
+/**
+ * Set the capture latency of the output ports to the largest capture latency at the input
+ * ports plus the latency of the graph in front of each output port, and the playback latency
+ * of the input ports to the largest playback latency at an output port plus the latency of
+ * the graph in front of it.
+ *
+ * Runs in a JACK notification thread.
+ */
+void JackDriver::reportLatency(jack_latency_callback_mode_t mode)
+{
+    std::lock_guard<std::mutex> lock(portsMutex);
+    if(mode == JackPlaybackLatency) {
+        jack_nframes_t outputLatency = 0;
+        for(JackPort *port : ports) {
+            if(!port->isInput()) {
+                jack_latency_range_t range;
+                jack_port_get_latency_range(port->getJackPort(), JackPlaybackLatency, &range);
+                outputLatency = std::max(outputLatency, range.max + port->getLatency());
+            }
+        }
+        for(JackPort *port : ports) {
+            if(port->isInput()) {
+                jack_latency_range_t range;
+                range.min = range.max = outputLatency;
+                jack_port_set_latency_range(port->getJackPort(), JackPlaybackLatency, &range);
+            }
+        }
+        return;
+    }
+    jack_nframes_t inputLatency = 0;
+    for(JackPort *port : ports) {
+        if(port->isInput()) {
+            jack_latency_range_t range;
+            jack_port_get_latency_range(port->getJackPort(), JackCaptureLatency, &range);
+            inputLatency = std::max(inputLatency, range.max);
+        }
+    }
+    for(JackPort *port : ports) {
+        if(!port->isInput()) {
+            jack_latency_range_t range;
+            range.min = range.max = inputLatency + port->getLatency();
+            jack_port_set_latency_range(port->getJackPort(), JackCaptureLatency, &range);
+        }
+    }
+}
+
+void JackDriver::connectPort(DriverPort *port, const char *connection)
+{
+    JackPort *jackPort = static_cast<JackPort*>(port);
+    if(jackPort->isInput()) {
+        jack_connect(client, connection, jackPort->getName());
+    } else {
+        jack_connect(client, jackPort->getName(), connection);
+    }
+}
+
+void JackDriver::disconnectPort(DriverPort *port, const char *connection)
+{
+    JackPort *jackPort = static_cast<JackPort*>(port);
+    if(jackPort->isInput()) {
+        jack_disconnect(client, connection, jackPort->getName());
+    } else {
+        jack_disconnect(client, jackPort->getName(), connection);
+    }
+}
+
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef JACKDRIVER_H
+#define JACKDRIVER_H
+
+#include "audiodriver.h"
+
+#include <jack/jack.h>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace bipscript {
+
+class JackPort : public DriverPort
+{
+    jack_port_t *port;
+    bool input;
+public:
+    JackPort(jack_port_t *port, bool input) : port(port), input(input) {}
+    jack_port_t *getJackPort() { return port; }
+    bool isInput() { return input; }
+    const char *getName() { return jack_port_name(port); }
+    void *getBuffer(jack_nframes_t nframes) {
+        return jack_port_get_buffer(port, nframes);
+    }
+    uint32_t getMidiEventCount(void *buffer) {
+        return jack_midi_get_event_count(buffer);
+    }
+    void getMidiEvent(void *buffer, uint32_t index, jack_midi_event_t &event) {
+        jack_midi_event_get(&event, buffer, index);
+    }
+    void clearMidiBuffer(void *buffer) {
+        jack_midi_clear_buffer(buffer);
+    }
+    jack_midi_data_t *reserveMidiEvent(void *buffer, jack_nframes_t time, size_t size) {
+        return jack_midi_event_reserve(buffer, time, size);
+    }
+};
+
+/**
+ * Driver for a JACK client, the JACK server owns the clock and the transport.
+ */
+class JackDriver : public AudioDriver
+{
+    jack_client_t *client;
+    std::set<JackPort*> ports;
+    std::mutex portsMutex;
+public:
+    JackDriver() : client(0) {}
+    int activate(const char *clientName);
+    void shutdown();
+    jack_nframes_t getSampleRate() {
+        return jack_get_sample_rate(client);
+    }
+    jack_nframes_t getBufferSize() {
+        return jack_get_buffer_size(client);
+    }
+    int getRealtimePriority() {
+        return jack_client_real_time_priority(client);
+    }
+    // transport
+    bool queryTransport(jack_position_t &pos) {
+        return jack_transport_query(client, &pos) == JackTransportRolling;
+    }
+    jack_nframes_t getLastFrameTime() {
+        return jack_last_frame_time(client);
+    }
+    void transportStart() {
+        jack_transport_start(client);
+    }
+    void transportStop() {
+        jack_transport_stop(client);
+    }
+    void transportLocate(jack_nframes_t frame) {
+        jack_transport_locate(client, frame);
+    }
+    bool setTimebaseMaster(transport::Master *master);
+    void releaseTimebaseMaster() {
+        jack_release_timebase(client);
+    }
+    // system ports
+    DriverPort *registerPort(const char *name, DriverPort::Type type);
+    void unregisterPort(DriverPort *port);
+    void connectPort(DriverPort *port, const char *connection);
+    void disconnectPort(DriverPort *port, const char *connection);
+    void latencyChanged();
+    void reportLatency(jack_latency_callback_mode_t mode);
+};
+
+}
+
+#endif // JACKDRIVER_H
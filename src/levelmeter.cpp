@@ -0,0 +1,112 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "levelmeter.h"
+
+namespace bipscript {
+namespace audio {
+
+// quietest level reported in decibels
+const float LEVEL_FLOOR = -120;
+
+/**
+ * Runs in the script thread.
+ */
+LevelMeter::LevelMeter(uint32_t channels) :
+    channelCount(channels), sequence(0)
+{
+    levels = new simd::Levels[channels]();
+    snapshot = new std::atomic<float>[channels * 3];
+    for(uint32_t i = 0; i < channels * 3; i++) {
+        snapshot[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+LevelMeter::~LevelMeter()
+{
+    delete[] levels;
+    delete[] snapshot;
+}
+
+/**
+ * Forget the levels added since the last snapshot.
+ *
+ * Runs in the process thread.
+ */
+void LevelMeter::clear()
+{
+    for(uint32_t i = 0; i < channelCount; i++) {
+        levels[i] = simd::Levels();
+    }
+}
+
+/**
+ * Write the levels added over the given number of frames to the snapshot and start over,
+ * the history of each channel carries on.
+ *
+ * Runs in the process thread.
+ */
+void LevelMeter::publish(jack_nframes_t frames)
+{
+    uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(uint32_t i = 0; i < channelCount; i++) {
+        simd::Levels &channel = levels[i];
+        float rms = frames ? std::sqrt(channel.squares / frames) : 0;
+        float truePeak = channel.truePeak > channel.peak ? channel.truePeak : channel.peak;
+        snapshot[i * 3].store(channel.peak, std::memory_order_relaxed);
+        snapshot[i * 3 + 1].store(rms, std::memory_order_relaxed);
+        snapshot[i * 3 + 2].store(truePeak, std::memory_order_relaxed);
+        channel.peak = 0;
+        channel.squares = 0;
+        channel.truePeak = 0;
+    }
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+/**
+ * Copy the levels of a channel from the latest snapshot.
+ *
+ * Runs in any thread.
+ */
+LevelReading LevelMeter::read(uint32_t channel)
+{
+    LevelReading reading;
+    uint32_t start;
+    do {
+        start = sequence.load(std::memory_order_acquire);
+        reading.peak = snapshot[channel * 3].load(std::memory_order_relaxed);
+        reading.rms = snapshot[channel * 3 + 1].load(std::memory_order_relaxed);
+        reading.truePeak = snapshot[channel * 3 + 2].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while((start & 1) || start != sequence.load(std::memory_order_relaxed));
+    return reading;
+}
+
+/**
+ * Level in decibels relative to full scale, no lower than the floor.
+ */
+float LevelMeter::decibels(float level)
+{
+    if(level <= 0) {
+        return LEVEL_FLOOR;
+    }
+    float result = 20 * std::log10(level);
+    return result > LEVEL_FLOOR ? result : LEVEL_FLOOR;
+}
+
+}}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LEVELMETER_H
+#define LEVELMETER_H
+
+#include "simd.h"
+
+#include <jack/types.h>
+#include <atomic>
+#include <cstdint>
+
+namespace bipscript {
+namespace audio {
+
+/**
+ * Published levels of one channel, linear.
+ */
+struct LevelReading
+{
+    float peak;
+    float rms;
+    float truePeak;
+};
+
+/**
+ * Levels of a number of channels, added up by the process thread and published as a
+ * snapshot that any thread can read without a lock. The sequence is odd while the process
+ * thread writes the snapshot and readers retry until they copied a channel between two
+ * writes (seqlock).
+ */
+class LevelMeter
+{
+    const uint32_t channelCount;
+    simd::Levels *levels; // process thread
+    std::atomic<uint32_t> sequence;
+    std::atomic<float> *snapshot; // peak, rms and true peak of each channel
+public:
+    LevelMeter(uint32_t channels);
+    ~LevelMeter();
+    simd::Levels &getLevels(uint32_t channel) { return levels[channel]; }
+    void clear();
+    void publish(jack_nframes_t frames);
+    LevelReading read(uint32_t channel);
+    static float decibels(float level);
+};
+
+}}
+
+#endif // LEVELMETER_H
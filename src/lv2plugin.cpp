@@ -121,6 +121,7 @@ Constants::Constants(LilvWorld *world) {
     lv2InputPort = lilv_new_uri(world, LV2_CORE__InputPort);
     lv2OutputPort = lilv_new_uri(world, LV2_CORE__OutputPort);
     lv2ControlPort = lilv_new_uri(world, LV2_CORE__ControlPort);
+    lv2ReportsLatency = lilv_new_uri(world, LV2_CORE__reportsLatency);
     lv2MidiEvent = lilv_new_uri(world, LILV_URI_MIDI_EVENT);
     lv2AtomSequence = lilv_new_uri(world, LV2_ATOM__Sequence);
     lv2AtomSupports = lilv_new_uri(world, LV2_ATOM__supports);
@@ -157,7 +158,6 @@ void MidiInput::process(bool rolling, jack_position_t &pos, jack_nframes_t nfram
     midi::MidiConnection *connection = eventConnector.getConnection();
     uint32_t eventCount = 0;
     if(connection) {
-        connection->getSource()->process(rolling, pos, nframes, time);
         eventCount = connection->getEventCount();
     }
 
@@ -182,7 +182,7 @@ void MidiInput::process(bool rolling, jack_position_t &pos, jack_nframes_t nfram
         // get next event
         if(bufferNext) {
             // recycle and get next buffer event
-            ObjectCollector::scriptCollector().recycle(bufferEvent);
+            eventBuffer.release(bufferEvent);
             bufferEvent = eventBuffer.getNextEvent(rolling, pos, nframes);
         } else {
             connectionEvent = eventIndex < eventCount ? connection->getEvent(eventIndex++) : 0;
@@ -192,6 +192,50 @@ void MidiInput::process(bool rolling, jack_position_t &pos, jack_nframes_t nfram
 
 // ----------------------------- Lv2MidiOutput
 
+/**
+ * Fill the connected sequence with the events of the period in frames start to end,
+ * relative to the start.
+ *
+ * Runs in the process thread.
+ */
+void MidiInput::selectSegment(jack_nframes_t start, jack_nframes_t end)
+{
+    lv2_atom_sequence_clear(atomSequence);
+    LV2_ATOM_SEQUENCE_FOREACH(periodSequence, ev) {
+        int64_t frame = ev->time.frames;
+        // events before the first segment were clamped to zero
+        if(frame >= (int64_t)end) {
+            break;
+        }
+        if(frame >= (int64_t)start) {
+            LV2_Atom_Event *copy = lv2_atom_sequence_append_event(atomSequence, CAPACITY, ev);
+            if(copy) {
+                copy->time.frames = frame - start;
+            }
+        }
+    }
+}
+
+/**
+ * Append the events the plugin wrote in the segment starting at the given frame to the
+ * period, relative to the start of the period.
+ *
+ * Runs in the process thread.
+ */
+void MidiOutput::collectSegment(jack_nframes_t start)
+{
+    if(!start) {
+        memcpy(periodSequence, atomSequence, sizeof(LV2_Atom_Sequence));
+        lv2_atom_sequence_clear(periodSequence);
+    }
+    LV2_ATOM_SEQUENCE_FOREACH(atomSequence, ev) {
+        LV2_Atom_Event *copy = lv2_atom_sequence_append_event(periodSequence, CAPACITY, ev);
+        if(copy) {
+            copy->time.frames += start;
+        }
+    }
+}
+
 uint32_t MidiOutput::getEventCount()
 {
     uint32_t counter = 0;
@@ -220,34 +264,55 @@ midi::Event *MidiOutput::getEvent(uint32_t i)
     return 0;
 }
 
+/**
+ * Map a controller on any channel to a control port and pass the rebuilt dispatch table
+ * to the process thread.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates PortControlTable.
+ */
+void ControlConnection::addMapping(unsigned int cc, ControlPort *port, const ControlCurve &curve)
+{
+    PortControlTable::Mapping mapping;
+    mapping.channel = -1;
+    mapping.cc = cc;
+    mapping.target.port = port;
+    mapping.curve = curve;
+    mappings.push_back(mapping);
+    // a table the process thread has not picked up yet is replaced
+    delete pendingTable.exchange(new PortControlTable(mappings));
+}
+
+/**
+ * Set the control ports mapped to the controller events on this connection.
+ *
+ * Runs in the process thread.
+ */
 void ControlConnection::process(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time)
 {
-    connection->getSource()->process(rolling, pos, nframes, time);
-    u_int32_t eventIndex = 0;
+    PortControlTable *fresh = pendingTable.exchange(0);
+    if(fresh) {
+        if(table) {
+            ObjectCollector::scriptCollector().recycle(table);
+        }
+        table = fresh;
+    }
+    if(!table) {
+        return;
+    }
     u_int32_t eventCount = connection->getEventCount();
-    while(eventIndex < eventCount) {
+    for(u_int32_t eventIndex = 0; eventIndex < eventCount; eventIndex++) {
         midi::Event *nextEvent = connection->getEvent(eventIndex);
         if(nextEvent->matches(midi::Event::TYPE_CONTROL)) {
-            // check mappings
-            ControlMapping *mapping = mappings.getFirst();
-            while(mapping) {
-                mapping->update(nextEvent->getDatabyte1(), nextEvent->getDatabyte2());
-                mapping = mappings.getNext(mapping);
+            uint8_t channel = nextEvent->channel;
+            uint8_t cc = nextEvent->getDatabyte1();
+            uint8_t value = nextEvent->getDatabyte2() & 0x7f;
+            const PortControlTable::Dispatch *end = table->end(channel, cc);
+            for(const PortControlTable::Dispatch *dispatch = table->begin(channel, cc); dispatch != end; dispatch++) {
+                dispatch->target.port->value = dispatch->values[value];
             }
         }
-        // pull up next event
-        nextEvent = eventIndex < eventCount ? connection->getEvent(eventIndex++) : 0;
-    }
-}
-
-void ControlConnection::reset()
-{
-    // recycle mappings
-    ControlMapping *mapping = mappings.getFirst();
-    while (mapping) {
-        ControlMapping *done = mapping;
-        mapping = mappings.pop();
-        ObjectCollector::scriptCollector().recycle(done);
     }
 }
 
@@ -255,13 +320,14 @@ void ControlConnection::reset()
 
 Plugin::Plugin(const LilvPlugin *plugin, LilvInstance *instance,
                      const Constants &uris, Worker *worker) :
-    plugin(plugin), instance(instance), midiOutputCount(0),
-    controlConnections(4), newControlMappingsQueue(16), worker(worker)
+    plugin(plugin), instance(instance), midiOutputCount(0), latencyPort(0), latency(0),
+    controlConnections(4), worker(worker)
 {
     // audio inputs
     audioInputCount = lilv_plugin_get_num_ports_of_class(plugin, uris.lv2AudioPort, uris.lv2InputPort, 0);
     audioInputIndex = new uint32_t[audioInputCount];
     audioInput = new audio::AudioConnector[audioInputCount];
+    inputAudio = new float*[audioInputCount];
 
     // audio outputs
     audioOutputCount = lilv_plugin_get_num_ports_of_class(plugin, uris.lv2AudioPort, uris.lv2OutputPort, 0);
@@ -301,6 +367,11 @@ Plugin::Plugin(const LilvPlugin *plugin, LilvInstance *instance,
             lilv_instance_connect_port(instance, i, &(newPort->value));
             controlMap[portName] = newPort;
 
+        } else if(lilv_port_is_a(plugin, port, uris.lv2ControlPort)
+                  && lilv_port_has_property(plugin, port, uris.lv2ReportsLatency)) {
+            // latency output, read after each run
+            lilv_instance_connect_port(instance, i, &latencyPort);
+
         } else if(lilv_port_is_a(plugin, port, uris.lv2AtomPort)) {
             // is it a MIDI/atom input?
             LilvNodes *atomBufferType = lilv_port_get_value(plugin, port, uris.lv2AtomBufferType);
@@ -548,20 +619,17 @@ void Plugin::scheduleControl(const char *symbol, float value, int bar, int posit
 }
 
 /**
- * Add a control
+ * Map a MIDI controller to a control port through the given curve.
+ *
+ * Runs in the script thread.
  */
-
-void Plugin::addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum, float maximum) {
+void Plugin::mapController(midi::Source &source, unsigned int cc, ControlPort *port, const ControlCurve &curve) {
     if(cc == 0) {
         throw std::logic_error("There is no MIDI control number zero");
     }
     if(cc > 127) {
         throw std::logic_error("MIDI control number cannot be greater than 127");
     }
-    if(minimum > maximum) {
-        throw std::logic_error("Minimum cannot be greater than maximum");
-    }
-    ControlPort *port = getPort(symbol);
     midi::MidiConnection *connection = source.getMidiConnection(0); // TODO: how to specify other connections
     // check hash for existing connection
     ControlConnection *controlConnection = controlConnectionMap[connection];
@@ -570,9 +638,17 @@ void Plugin::addController(midi::Source &source, unsigned int cc, const char *sy
         controlConnection = new ControlConnection(connection);
         controlConnectionMap[connection] = controlConnection;
         controlConnections.add(controlConnection);
+        AudioEngine::instance().graphChanged();
     }
-    // push new mapping
-    while(!newControlMappingsQueue.push(new ControlMapping(controlConnection, cc, port, minimum, maximum)));
+    controlConnection->addMapping(cc, port, curve);
+}
+
+/**
+ * Add a control
+ */
+
+void Plugin::addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum, float maximum) {
+    addController(source, cc, symbol, minimum, maximum, "linear");
 }
 
 void Plugin::addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum) {
@@ -585,6 +661,45 @@ void Plugin::addController(midi::Source &source, unsigned int cc, const char *sy
     addController(source, cc, symbol, port->minimum, port->maximum);
 }
 
+void Plugin::addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum, float maximum,
+                           const char *curve) {
+    if(minimum > maximum) {
+        throw std::logic_error("Minimum cannot be greater than maximum");
+    }
+    ControlPort *port = getPort(symbol);
+    if(std::strcmp(curve, "linear") == 0) {
+        mapController(source, cc, port, ControlCurve::linear(minimum, maximum));
+    }
+    else if(std::strcmp(curve, "log") == 0) {
+        mapController(source, cc, port, ControlCurve::logarithmic(minimum, maximum));
+    }
+    else {
+        throw std::logic_error("Unknown controller curve, should be linear or log");
+    }
+}
+
+/**
+ * Map a MIDI controller to a control port through a table of port values, values
+ * between the table points are interpolated.
+ */
+void Plugin::addControllerTable(midi::Source &source, unsigned int cc, const char *symbol, ScriptArray &values) {
+    std::vector<float> points;
+    for(uint32_t i = 0; i < values.size(); i++) {
+        ScriptValue &value = values[i];
+        if(value.type == FLOAT) {
+            points.push_back(value.floatValue);
+        }
+        else if(value.type == INTEGER) {
+            points.push_back(value.intValue);
+        }
+        else {
+            throw std::logic_error("controller table value should be a number");
+        }
+    }
+    ControlPort *port = getPort(symbol);
+    mapController(source, cc, port, ControlCurve::table(points));
+}
+
 /**
  * Restore clean state on a cached plugin before reuse
  *
@@ -604,23 +719,26 @@ void Plugin::addMidiEvent(midi::Event *evt) {
     }
 }
 
-bool Plugin::connectsTo(AbstractSource *source) {
-    // event inputs
+/**
+ * Reports connected MIDI inputs, audio inputs and control connections.
+ *
+ * Runs in the script thread.
+ */
+void Plugin::getSources(std::vector<Processor*> &sources) {
     MidiInput *midiInput = midiInputList.getFirst();
     while(midiInput) {
-        if(midiInput->connectsTo(source)) {
-            return true;
-        }
+        midiInput->getSources(sources);
         midiInput = midiInputList.getNext(midiInput);
     }
-    // audio inputs
     for(uint32_t i = 0; i < audioInputCount; i++) {
         audio::AudioConnection *connection = audioInput[i].getConnection();
-        if(connection && connection->getSource()->connectsTo(source)) {
-            return true;
+        if(connection) {
+            sources.push_back(connection->getSource());
         }
     }
-    return false;
+    for(auto it = controlConnectionMap.begin(); it != controlConnectionMap.end(); it++) {
+        sources.push_back(it->first->getSource());
+    }
 }
 
 midi::MidiConnection *Plugin::getMidiConnection(unsigned int index) {
@@ -635,12 +753,6 @@ midi::MidiConnection *Plugin::getMidiConnection(unsigned int index) {
 
 void Plugin::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time) {
 
-    // pull in new control mappings
-    ControlMapping *freshMapping;
-    while(newControlMappingsQueue.pop(freshMapping)) {
-        freshMapping->getConnection()->addMapping(freshMapping);
-    }
-
     // process MIDI inputs
     MidiInput *midiInput = midiInputList.getFirst();
     while(midiInput) {
@@ -648,22 +760,12 @@ void Plugin::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframe
         midiInput = midiInputList.getNext(midiInput);
     }
 
-    // process and connect audio inputs
-    for(uint32_t i = 0; i < audioInputCount; i++) {
-        audio::AudioConnection *connection = audioInput[i].getConnection();
-        if(connection) {
-            connection->getSource()->process(rolling, pos, nframes, time);
-            lilv_instance_connect_port(instance, audioInputIndex[i], connection->getAudio());
-        } else {
-            lilv_instance_connect_port(instance, audioInputIndex[i], audio::AudioConnection::getDummyBuffer());
-        }
-    }
-
-    // update control port values from scheduled control events
+    // update control port values from scheduled control events due in the first sub-block
+    jack_nframes_t minimum = AudioEngine::instance().getSubBlockMinimum();
     ControlEvent* evt = controlBuffer.getNextEvent(rolling, pos, nframes);
-    while(evt) {
+    while(evt && (!minimum || evt->getFrameOffset() < (long)minimum)) {
         evt->getPort()->value = evt->getValue();
-        ObjectCollector::scriptCollector().recycle(evt);
+        controlBuffer.release(evt);
         evt = controlBuffer.getNextEvent(rolling, pos, nframes);
     }
 
@@ -674,20 +776,52 @@ void Plugin::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframe
         connection = controlConnections.getNext(connection);
     }
 
-    // clear event output buffers
-    MidiOutput *midiOutput = midiOutputList.getFirst();
-    while(midiOutput) {
-        midiOutput->clear();
-        midiOutput = midiOutputList.getNext(midiOutput);
+    // read audio inputs once, delayed inputs advance per read
+    for(uint32_t i = 0; i < audioInputCount; i++) {
+        inputAudio[i] = audioInput[i].readAudio(nframes);
     }
 
-    // set up audio output buffers
+    // split the period where later control events are due
+    bool split = evt;
+    if(split) {
+        midiInput = midiInputList.getFirst();
+        while(midiInput) {
+            midiInput->beginSegments();
+            midiInput = midiInputList.getNext(midiInput);
+        }
+    }
+    jack_nframes_t start = 0;
+    while(evt) {
+        jack_nframes_t end = evt->getFrameOffset();
+        runSegment(start, end, true);
+        start = end;
+        // events closer than the minimum to the split apply together
+        while(evt && evt->getFrameOffset() < (long)(start + minimum)) {
+            evt->getPort()->value = evt->getValue();
+            controlBuffer.release(evt);
+            evt = controlBuffer.getNextEvent(rolling, pos, nframes);
+        }
+    }
+    runSegment(start, nframes, split);
+    if(split) {
+        MidiOutput *midiOutput = midiOutputList.getFirst();
+        while(midiOutput) {
+            midiOutput->endSegments();
+            midiOutput = midiOutputList.getNext(midiOutput);
+        }
+    }
+
+    // flag idle outputs for downstream processors
     for(uint32_t i = 0; i < audioOutputCount; i++) {
-        lilv_instance_connect_port(instance, audioOutputIndex[i], audioOutput[i]->getAudio());
+        audioOutput[i]->detectState(nframes);
     }
 
-    // run the plugin
-    lilv_instance_run(instance, nframes);
+    // a new latency changes the delays of the graph
+    jack_nframes_t reported = latencyPort > 0 ? latencyPort : 0;
+    if(reported != latency.load(std::memory_order_relaxed)) {
+        latency.store(reported);
+        AudioEngine::instance().graphChanged();
+    }
 
     // fire MIDI events
     fireMidiEvents(pos);
@@ -698,6 +832,53 @@ void Plugin::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframe
     }
 }
 
+/**
+ * Run the plugin over frames start to end of the period, only a split period passes the
+ * MIDI events of each segment separately.
+ *
+ * Runs in the process thread.
+ */
+void Plugin::runSegment(jack_nframes_t start, jack_nframes_t end, bool split)
+{
+    // connect audio inputs
+    for(uint32_t i = 0; i < audioInputCount; i++) {
+        lilv_instance_connect_port(instance, audioInputIndex[i], inputAudio[i] + start);
+    }
+
+    // select MIDI input events
+    if(split) {
+        MidiInput *midiInput = midiInputList.getFirst();
+        while(midiInput) {
+            midiInput->selectSegment(start, end);
+            midiInput = midiInputList.getNext(midiInput);
+        }
+    }
+
+    // clear event output buffers
+    MidiOutput *midiOutput = midiOutputList.getFirst();
+    while(midiOutput) {
+        midiOutput->clear();
+        midiOutput = midiOutputList.getNext(midiOutput);
+    }
+
+    // set up audio output buffers
+    for(uint32_t i = 0; i < audioOutputCount; i++) {
+        lilv_instance_connect_port(instance, audioOutputIndex[i], audioOutput[i]->getAudio() + start);
+    }
+
+    // run the plugin
+    lilv_instance_run(instance, end - start);
+
+    // collect MIDI output events
+    if(split) {
+        midiOutput = midiOutputList.getFirst();
+        while(midiOutput) {
+            midiOutput->collectSegment(start);
+            midiOutput = midiOutputList.getNext(midiOutput);
+        }
+    }
+}
+
 void Plugin::reposition() {
     // reset MIDI inputs
     MidiInput *midiInput = midiInputList.getFirst();
@@ -709,7 +890,6 @@ void Plugin::reposition() {
     // recycle control connection
     ControlConnection *connection = controlConnections.getFirst();
     while(connection) {
-        connection->reset();
         ControlConnection *done = connection;
         connection = controlConnections.pop();
         ObjectCollector::scriptCollector().recycle(done);
@@ -719,6 +899,20 @@ void Plugin::reposition() {
     controlBuffer.recycleRemaining();
 }
 
+void Plugin::relocate() {
+    MidiInput *midiInput = midiInputList.getFirst();
+    while(midiInput) {
+        midiInput->relocate();
+        midiInput = midiInputList.getNext(midiInput);
+    }
+    controlBuffer.relocate();
+}
+
+std::string Plugin::getLabel()
+{
+    return std::string("Lv2.Plugin ") + lilv_node_as_uri(lilv_plugin_get_uri(plugin));
+}
+
 void Plugin::print() {
 
     std::cout << "----------- plugin " << this << std::endl;
@@ -26,6 +26,7 @@
 #include <jack/ringbuffer.h>
 #include <semaphore.h>
 
+#include <cstring>
 #include <map>
 #include <list>
 #include <set>
@@ -36,6 +37,7 @@
 #include "midisink.h"
 #include "scripttypes.h"
 #include "objectcache.h"
+#include "controltable.h"
 
 namespace bipscript {
 namespace lv2 {
@@ -67,6 +69,7 @@ public:
     LilvNode *lv2InputPort;
     LilvNode *lv2OutputPort;
     LilvNode *lv2ControlPort;
+    LilvNode *lv2ReportsLatency;
     // midi
     LilvNode *lv2MidiEvent;
     // atom
@@ -107,12 +110,14 @@ class MidiInput : public Listable
 {
     const u_int32_t CAPACITY = 1024;
     LV2_Atom_Sequence *atomSequence;
+    LV2_Atom_Sequence *periodSequence; // events of the whole period when it is split
     midi::MidiConnector eventConnector;
     EventBuffer<midi::Event> eventBuffer;
     bool localRolling;
 public:
     MidiInput() : localRolling(false) {
         atomSequence = static_cast<LV2_Atom_Sequence *>(malloc(sizeof(LV2_Atom_Sequence) + CAPACITY));
+        periodSequence = static_cast<LV2_Atom_Sequence *>(malloc(sizeof(LV2_Atom_Sequence) + CAPACITY));
     }
     LV2_Atom_Sequence *getAtomSequence() {
         return atomSequence;
@@ -120,9 +125,11 @@ public:
     void connect(midi::MidiConnection *connection, midi::Source *source) {
         eventConnector.setConnection(connection, source);
     }
-    bool connectsTo(AbstractSource *source) {
+    void getSources(std::vector<Processor*> &sources) {
         midi::MidiConnection *connection = eventConnector.getConnection();
-        return connection && connection->getSource()->connectsTo(source);
+        if(connection) {
+            sources.push_back(connection->getSource());
+        }
     }
     void addEvent(midi::Event *evt) {
         eventBuffer.addEvent(evt);
@@ -130,21 +137,30 @@ public:
     void reset() {
         eventBuffer.recycleRemaining();
     }
+    void relocate() {
+        eventBuffer.relocate();
+    }
     void process(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
     void update() {
         eventBuffer.update();
     }
+    void beginSegments() {
+        memcpy(periodSequence, atomSequence, sizeof(LV2_Atom) + atomSequence->atom.size);
+    }
+    void selectSegment(jack_nframes_t start, jack_nframes_t end);
 };
 
 class MidiOutput : public Listable, public midi::MidiConnection
 {
     const u_int32_t CAPACITY = 1024;
     LV2_Atom_Sequence *atomSequence;    
+    LV2_Atom_Sequence *periodSequence; // events of the whole period when it is split
     midi::Event event;
 public:
     MidiOutput(midi::Source *source) : midi::MidiConnection(source) {
         atomSequence = (LV2_Atom_Sequence *)malloc(sizeof(LV2_Atom_Sequence) + CAPACITY);
         atomSequence->atom.size = CAPACITY;
+        periodSequence = (LV2_Atom_Sequence *)malloc(sizeof(LV2_Atom_Sequence) + CAPACITY);
     }
     LV2_Atom_Sequence *getAtomSequence() {
         return atomSequence;
@@ -152,6 +168,10 @@ public:
     void clear() {
         atomSequence->atom.size = CAPACITY;
     }
+    void collectSegment(jack_nframes_t start);
+    void endSegments() {
+        memcpy(atomSequence, periodSequence, sizeof(LV2_Atom) + periodSequence->atom.size);
+    }
     // EventConnection interface
     uint32_t getEventCount();
     midi::Event *getEvent(uint32_t i);
@@ -180,43 +200,28 @@ public:
     }
 };
 
-class ControlConnection;
-
-class ControlMapping : public Listable
+struct ControlTarget
 {
-    ControlConnection *const connection;
-    const uint8_t cc;
-    ControlPort *const port;
-    const float minimum;
-    const float maximum;
-    float getScaled(unsigned char midiValue) {
-        return minimum + (maximum - minimum) * midiValue / 127;
-    }
-public:
-    ControlMapping(ControlConnection *connection, unsigned int cc,
-                      ControlPort *port, float minimum, float maximum) :
-        connection(connection), cc(cc), port(port), minimum(minimum), maximum(maximum) {
-    }
-    ControlConnection *getConnection() {
-        return connection;
-    }
-    void update(uint8_t cc, uint8_t value) {
-        if(this->cc == cc) {
-            port->value = getScaled(value);
-        }
-    }
+    ControlPort *port;
 };
 
+typedef ControlTable<ControlTarget> PortControlTable;
+
 class ControlConnection : public Listable
 {
-    List<ControlMapping> mappings;
     midi::MidiConnection *connection;
+    std::vector<PortControlTable::Mapping> mappings; // script thread
+    std::atomic<PortControlTable*> pendingTable;
+    PortControlTable *table; // process thread
 public:
     ControlConnection(midi::MidiConnection *connection) :
-        connection(connection) {}
-    void addMapping(ControlMapping *mapping) { mappings.add(mapping); }
+        connection(connection), pendingTable(0), table(0) {}
+    ~ControlConnection() {
+        delete pendingTable.load();
+        delete table;
+    }
+    void addMapping(unsigned int cc, ControlPort *port, const ControlCurve &curve);
     void process(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
-    void reset();
 };
 
 class State
@@ -261,10 +266,14 @@ class Plugin : public audio::Source, public midi::Source, public midi::Sink
     uint32_t audioInputCount;
     uint32_t *audioInputIndex;
     audio::AudioConnector *audioInput;
+    float **inputAudio; // this period, process thread
     // audio outputs
     uint32_t audioOutputCount;
     uint32_t *audioOutputIndex;
     audio::AudioConnection **audioOutput;
+    // latency reported by the plugin
+    float latencyPort;
+    std::atomic<jack_nframes_t> latency;
     // control ports
     EventBuffer<ControlEvent> controlBuffer;
     std::map<std::string, ControlPort *> controlMap;
@@ -273,7 +282,8 @@ class Plugin : public audio::Source, public midi::Source, public midi::Sink
     // control connections
     std::map<midi::MidiConnection*,ControlConnection*> controlConnectionMap;
     QueueList<ControlConnection> controlConnections;
-    boost::lockfree::spsc_queue<ControlMapping*> newControlMappingsQueue;
+    void runSegment(jack_nframes_t start, jack_nframes_t end, bool split);
+    void mapController(midi::Source &source, unsigned int cc, ControlPort *port, const ControlCurve &curve);
 public:
     static AtomTypes atomTypes;
     Plugin(const LilvPlugin *plugin, LilvInstance *instance, const Constants &uris, Worker *worker);
@@ -288,14 +298,25 @@ public:
     void addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum, float maximum);
     void addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum);
     void addController(midi::Source &source, unsigned int cc, const char *symbol);
+    void addController(midi::Source &source, unsigned int cc, const char *symbol, float minimum, float maximum,
+                       const char *curve);
+    void addControllerTable(midi::Source &source, unsigned int cc, const char *symbol, ScriptArray &values);
     void restore();
     // MidiSink
     void addMidiEvent(midi::Event* evt);
     // Source interface
-    bool connectsTo(AbstractSource *source);
     // Processor interface
+    void getSources(std::vector<Processor*> &sources);
+    void getAudioInputs(std::vector<audio::AudioConnector*> &inputs) {
+        for(uint32_t i = 0; i < audioInputCount; i++) {
+            inputs.push_back(&audioInput[i]);
+        }
+    }
+    jack_nframes_t getLatency() { return latency.load(); }
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
     void reposition();
+    void relocate();
+    std::string getLabel();
     // AudioSource interface
     unsigned int getAudioOutputCount() { return audioOutputCount; }
     audio::AudioConnection *getAudioConnection(unsigned int index) {
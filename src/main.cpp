@@ -16,12 +16,16 @@
  */
 
 #include <errno.h>
+#include <getopt.h>
 #include <string.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 #include "scripthost.h"
@@ -38,6 +42,11 @@
 #include "oscoutput.h"
 #include "extension.h"
 #include "transport.h"
+#include "renderdriver.h"
+#include "simulateddriver.h"
+#include "timeline.h"
+#include "rtsafety.h"
+#include "housekeeper.h"
 
 namespace fs = boost::filesystem;
 
@@ -52,31 +61,207 @@ void signal_handler(int sig)
     exit(0);
 }
 
+void dump_handler(int)
+{
+    AudioEngine::instance().getDeadlineMonitor().requestDump();
+}
+
+void graph_handler(int)
+{
+    AudioEngine::instance().requestGraphDump();
+}
+
+void usage()
+{
+    std::cerr << "Usage: bipscript [options] [script file] [script arguments]" << std::endl;
+    std::cerr << "       bipscript [options] --session [script file]..." << std::endl;
+    std::cerr << "      --session     run all given scripts in one client, port names are prefixed with" << std::endl;
+    std::cerr << "                    the script name" << std::endl;
+    std::cerr << "  -j, --workers N   run independent processors on N additional realtime threads" << std::endl;
+    std::cerr << "  -d, --deadlines   print callback timing and xruns when the script ends (also on SIGUSR1)" << std::endl;
+    std::cerr << "      --block N     process in blocks of N frames within each period for faster control" << std::endl;
+    std::cerr << "                    response (default one block per period)" << std::endl;
+    std::cerr << "      --subblock N  run plugins in parts of at least N frames to apply scheduled controls" << std::endl;
+    std::cerr << "                    on time, 0 applies them at the start of the period (default 32)" << std::endl;
+    std::cerr << "      --rt-check    lock memory and count allocations and locks in the process thread" << std::endl;
+    std::cerr << "      --rt-trace    like --rt-check, also print where the first calls came from" << std::endl;
+    std::cerr << "      --seamless    rerun the script in the background after a backward jump and switch" << std::endl;
+    std::cerr << "                    to its events at the next bar instead of stopping for the rerun" << std::endl;
+    std::cerr << "      --crossfade MS  fade outputs out and in around the seamless switch" << std::endl;
+    std::cerr << "      --timeline    keep events scheduled by the script on a timeline and relocate without" << std::endl;
+    std::cerr << "                    rerunning the script" << std::endl;
+    std::cerr << "  -r, --render DIR  render to files in DIR faster than realtime, without a server" << std::endl;
+    std::cerr << "      --from BAR    first bar to render (default 1)" << std::endl;
+    std::cerr << "      --to BAR      last bar to render, required with --render" << std::endl;
+    std::cerr << "  -s, --simulate N  run N periods on a simulated clock without a server and print timings" << std::endl;
+    std::cerr << "      --sequence S  simulated transport and xruns, e.g. 0:start,400:locate=96000,500:xrun=2" << std::endl;
+    std::cerr << "                    (default 0:start), tone=HZ plays a sine into the audio inputs and" << std::endl;
+    std::cerr << "                    cc=CHANNEL/CONTROLLER/VALUE sends a controller to the MIDI inputs" << std::endl;
+    std::cerr << "      --rate HZ     render or simulation sample rate (default 48000)" << std::endl;
+    std::cerr << "      --period N    render or simulation period size in frames (default 1024)" << std::endl;
+}
+
 int main(int argc, char **argv)
 {
-    if(argc < 2) {
-        std::cerr << "Usage: bipscript [script file]" << std::endl;
+    // engine options, stop at the script file
+    static struct option options[] = {
+        {"workers", required_argument, 0, 'j'},
+        {"deadlines", no_argument, 0, 'd'},
+        {"block", required_argument, 0, 'k'},
+        {"subblock", required_argument, 0, 'B'},
+        {"rt-check", no_argument, 0, 'c'},
+        {"rt-trace", no_argument, 0, 'b'},
+        {"seamless", no_argument, 0, 'm'},
+        {"crossfade", required_argument, 0, 'x'},
+        {"timeline", no_argument, 0, 'T'},
+        {"render", required_argument, 0, 'r'},
+        {"from", required_argument, 0, 'f'},
+        {"to", required_argument, 0, 't'},
+        {"rate", required_argument, 0, 'R'},
+        {"period", required_argument, 0, 'p'},
+        {"simulate", required_argument, 0, 's'},
+        {"sequence", required_argument, 0, 'S'},
+        {"session", no_argument, 0, 'n'},
+        {0, 0, 0, 0}
+    };
+    AudioEngine &audioEngine = AudioEngine::instance();
+    const char *renderFolder = 0;
+    int fromBar = 1, toBar = 0, renderRate = 48000, renderPeriod = 1024;
+    int simulatePeriods = 0;
+    bool deadlineReport = false;
+    int rtCheck = 0; // 1 = count, 2 = count and trace
+    bool seamless = false;
+    float crossfade = 0;
+    const char *sequence = "0:start";
+    bool session = false;
+    int opt;
+    while((opt = getopt_long(argc, argv, "+j:dr:s:", options, 0)) != -1) {
+        switch(opt) {
+        case 'j':
+            audioEngine.setWorkerCount(atoi(optarg));
+            break;
+        case 'd':
+            deadlineReport = true;
+            break;
+        case 'k':
+            audioEngine.setBlockSize(std::max(atoi(optarg), 0));
+            break;
+        case 'B':
+            audioEngine.setSubBlockMinimum(std::max(atoi(optarg), 0));
+            break;
+        case 'c':
+            rtCheck = rtCheck > 1 ? rtCheck : 1;
+            break;
+        case 'b':
+            rtCheck = 2;
+            break;
+        case 'm':
+            seamless = true;
+            break;
+        case 'x':
+            crossfade = atof(optarg);
+            break;
+        case 'T':
+            EventTimelines::instance().setEnabled(true);
+            break;
+        case 'r':
+            renderFolder = optarg;
+            break;
+        case 'f':
+            fromBar = atoi(optarg);
+            break;
+        case 't':
+            toBar = atoi(optarg);
+            break;
+        case 'R':
+            renderRate = atoi(optarg);
+            break;
+        case 'p':
+            renderPeriod = atoi(optarg);
+            break;
+        case 's':
+            simulatePeriods = atoi(optarg);
+            break;
+        case 'S':
+            sequence = optarg;
+            break;
+        case 'n':
+            session = true;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if(optind >= argc) {
+        usage();
         return 1;
     }
+    char *scriptFile = argv[optind];
 
-    // check given script file
-    fs::path filePath(argv[1]);
-    if(!exists(filePath)) {
-       std::cerr << "error: script file does not exist: " << argv[1] << std::endl;
-       return 2;
+    // check given script files, a session takes all remaining arguments
+    int scriptCount = session ? argc - optind : 1;
+    std::vector<std::string> scriptNames;
+    for(int i = optind; i < optind + scriptCount; i++) {
+        fs::path filePath(argv[i]);
+        if(!exists(filePath)) {
+           std::cerr << "error: script file does not exist: " << argv[i] << std::endl;
+           return 2;
+        }
+        if(is_directory(filePath)) {
+           std::cerr << "error: script file is a directory: " << argv[i] << std::endl;
+           return 2;
+        }
+        // port prefix from the file name, numbered if two scripts have the same name
+        std::string name = filePath.stem().string();
+        if(std::count(scriptNames.begin(), scriptNames.end(), name)) {
+            name += "_" + std::to_string(i - optind + 1);
+        }
+        scriptNames.push_back(name);
     }
-    if(is_directory(filePath)) {
-       std::cerr << "error: script file is a directory: " << argv[1] << std::endl;
-       return 2;
+
+    audioEngine.setSeamlessRestart(seamless, crossfade);
+
+    // check render options
+    if(renderFolder) {
+        if(fromBar < 1 || toBar < fromBar || renderRate <= 0 || renderPeriod <= 0) {
+            std::cerr << "error: render needs --to BAR not before --from BAR and a positive rate and period" << std::endl;
+            return 2;
+        }
+        if(!is_directory(fs::path(renderFolder))) {
+            std::cerr << "error: render folder is not a directory: " << renderFolder << std::endl;
+            return 2;
+        }
+        audioEngine.setDriver(new RenderDriver(renderFolder, fromBar, toBar, renderRate, renderPeriod));
+    }
+    else if(simulatePeriods) {
+        if(simulatePeriods < 0 || renderRate <= 0 || renderPeriod <= 0) {
+            std::cerr << "error: simulation needs a positive number of periods, rate and period" << std::endl;
+            return 2;
+        }
+        SimulatedDriver *driver = new SimulatedDriver(simulatePeriods, renderRate, renderPeriod);
+        if(!driver->setSequence(sequence)) {
+            std::cerr << "error: invalid simulation sequence: " << sequence << std::endl;
+            return 2;
+        }
+        audioEngine.setDriver(driver);
     }
-    fs::path parentPath = system_complete(filePath).parent_path();
 
-    // initialize system
-    system::System::setArguments(argc, argv);
+    // initialize system, the options are hidden so argument 0 stays the program and 1 the script
+    argv[optind - 1] = argv[0];
+    system::System::setArguments(argc - optind + 1, argv + optind - 1);
 
     // create script host
     ScriptHost &host = ScriptHost::instance();
-    host.setScriptFile(parentPath.c_str(), argv[1]);
+    for(int i = 0; i < scriptCount; i++) {
+        char *file = argv[optind + i];
+        fs::path parentPath = system_complete(fs::path(file)).parent_path();
+        if(session) {
+            host.addScript(parentPath.c_str(), file, scriptNames[i]);
+        } else {
+            host.setScriptFile(parentPath.c_str(), file);
+        }
+    }
 
     // add object caches
     ObjectCache *caches[] = {
@@ -96,9 +281,15 @@ int main(int argc, char **argv)
                             };
     host.setObjectCaches(13, caches);
 
-    // create and  start audioengine
-    AudioEngine &audioEngine = AudioEngine::instance();
-    int status = audioEngine.activate(argv[1]); // use script name as client name
+    // lock memory and start watching the process thread
+    if(rtCheck) {
+        RtSafety::instance().lockMemory();
+        RtSafety::instance().enable(rtCheck > 1);
+    }
+
+    // start audioengine
+    // use script name as client name
+    int status = audioEngine.activate(session ? "bipscript" : scriptFile);
 
     // exit if audio engine failed to start
     if(status) {
@@ -110,17 +301,27 @@ int main(int argc, char **argv)
     signal(SIGTERM, signal_handler);
     signal(SIGHUP, signal_handler);
     signal(SIGINT, signal_handler);
+    signal(SIGUSR1, dump_handler);
+    signal(SIGUSR2, graph_handler);
 
     // sample rate now valid
     jack_nframes_t sampleRate = audioEngine.getSampleRate();
     lv2::PluginCache::instance().setSampleRate(sampleRate);
 
+    // delete objects handed off by the process thread
+    Housekeeper::instance().start();
+
     // run script
     status = host.run();
 
     // script has ended
+    if(deadlineReport) {
+        audioEngine.getDeadlineMonitor().dump(std::cerr);
+    }
+    RtSafety::instance().dump(std::cerr);
     ExtensionManager::instance().shutdown();
     osc::OutputFactory::instance().shutdown();
     audioEngine.shutdown();
+    Housekeeper::instance().stop();
     return status;
 }
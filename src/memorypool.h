@@ -19,21 +19,47 @@
 
 #include <stddef.h>
 #include "tlsf.h"
+#include "workerindex.h"
 
 namespace bipscript {
 
 class MemoryPool
 {
     tlsf_t tlsf;
+    char *buffer;
+    size_t size;
+    static MemoryPool *workerPools[WorkerIndex::MAX_WORKERS];
 public:
-    MemoryPool(size_t size) {
-        void *buff = ::operator new(size);
-        tlsf = tlsf_create_with_pool(buff, size);
+    MemoryPool(size_t size) : size(size) {
+        buffer = static_cast<char*>(::operator new(size));
+        tlsf = tlsf_create_with_pool(buffer, size);
     }
     static MemoryPool &processPool() {
         static MemoryPool instance(32768);
         return instance;
     }
+    /**
+     * Pool of the process worker on the calling thread, the process pool on the process thread.
+     */
+    static MemoryPool &currentPool() {
+        uint16_t worker = WorkerIndex::current();
+        return worker ? *workerPools[worker] : processPool();
+    }
+    /**
+     * Pool a block came from, blocks are freed in the process thread while the workers wait.
+     */
+    static MemoryPool &owner(void *p) {
+        for(uint16_t worker = 1; worker < WorkerIndex::MAX_WORKERS && workerPools[worker]; worker++) {
+            if(workerPools[worker]->contains(p)) {
+                return *workerPools[worker];
+            }
+        }
+        return processPool();
+    }
+    static void createWorkerPools(uint16_t workers, size_t size);
+    bool contains(void *p) {
+        return static_cast<char*>(p) >= buffer && static_cast<char*>(p) < buffer + size;
+    }
     ~MemoryPool() { tlsf_destroy(tlsf); }
     void *malloc(size_t size) {
         // printf("malloc, ID of this thread is: %u\n", (unsigned int)pthread_self());
@@ -1,14 +1,48 @@
 #include "methodqueue.h"
+#include "scripttypes.h"
 
 namespace bipscript {
 
 void MethodQueue::dispatch(ScriptFunctionClosure *function)
 {
+    // process workers hold their methods until the process thread gathers them
+    uint16_t worker = WorkerIndex::current();
+    if(worker) {
+        WorkerMethods &methods = workerMethods[worker];
+        function->nextDispatched = 0;
+        if(methods.first) {
+            methods.last->nextDispatched = function;
+        } else {
+            methods.first = function;
+        }
+        methods.last = function;
+        return;
+    }
     // don't do this in process thread!
     // TODO: make a waiting queue instead
     while(!dispatchQueue.push(function));
 }
 
+/**
+ * Pass on the methods held by the process workers, in the order each worker dispatched them.
+ *
+ * Runs in the process thread after the workers have joined.
+ */
+void MethodQueue::gather(uint16_t workers)
+{
+    for(uint16_t worker = 1; worker <= workers; worker++) {
+        WorkerMethods &methods = workerMethods[worker];
+        ScriptFunctionClosure *function = methods.first;
+        while(function) {
+            ScriptFunctionClosure *next = function->nextDispatched;
+            while(!dispatchQueue.push(function));
+            function = next;
+        }
+        methods.first = 0;
+        methods.last = 0;
+    }
+}
+
 ScriptFunctionClosure *MethodQueue::next() {
     ScriptFunctionClosure *function;
     return dispatchQueue.pop(function) ? function : 0;
@@ -1,6 +1,8 @@
 #ifndef METHODQUEUE_H
 #define METHODQUEUE_H
 
+#include "workerindex.h"
+
 #include <boost/lockfree/spsc_queue.hpp>
 
 namespace bipscript {
@@ -14,8 +16,13 @@ class ScriptFunctionClosure;
  */
 class MethodQueue
 {    
+    struct WorkerMethods {
+        ScriptFunctionClosure *first;
+        ScriptFunctionClosure *last;
+    };
     boost::lockfree::spsc_queue<ScriptFunctionClosure*> dispatchQueue; // process thread -> script thread
-    MethodQueue() : dispatchQueue(512) {}
+    WorkerMethods workerMethods[WorkerIndex::MAX_WORKERS]; // held by each process worker
+    MethodQueue() : dispatchQueue(512), workerMethods() {}
 public:
     static MethodQueue &instance() {
         static MethodQueue instance;
@@ -23,6 +30,7 @@ public:
     }
     void dispatch(ScriptFunctionClosure *function);
     ScriptFunctionClosure *next();
+    void gather(uint16_t workers);
 };
 
 }
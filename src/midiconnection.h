@@ -26,6 +26,7 @@
 #include "bindmidi.h"
 #include "bindtransport.h"
 #include "timeposition.h"
+#include "audioengine.h"
 
 namespace bipscript {
 namespace midi {
@@ -168,11 +169,14 @@ class MidiConnector {
 public:
     MidiConnector() : connection(0) {}
     void setConnection(MidiConnection *conn, Source *source) {
-        Source *connSource = conn->getSource();
-        if(connSource == source || connSource->connectsTo(source)) {
+        if(!ConnectionIndex::instance().connect(conn->getSource(), source)) {
             throw std::logic_error("Cannot connect infinite loop");
         }
-        connection.store(conn);
+        MidiConnection *previous = connection.exchange(conn);
+        if(previous) {
+            ConnectionIndex::instance().disconnect(previous->getSource(), source);
+        }
+        AudioEngine::instance().graphChanged();
     }
     MidiConnection *getConnection() {
         return connection.load();
@@ -0,0 +1,132 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "midifilewriter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace bipscript {
+namespace midi {
+
+/**
+ * Add the delta time from the last event to the given tick.
+ */
+void MidiFileWriter::addDelta(double eventTick)
+{
+    uint32_t rounded = std::lround(eventTick);
+    if(rounded < lastTick) {
+        rounded = lastTick;
+    }
+    addVariableLength(rounded - lastTick);
+    lastTick = rounded;
+}
+
+void MidiFileWriter::addVariableLength(uint32_t value)
+{
+    uint8_t bytes[5];
+    int count = 0;
+    do {
+        bytes[count++] = value & 0x7f;
+        value >>= 7;
+    } while(value);
+    while(count > 1) {
+        track.push_back(bytes[--count] | 0x80);
+    }
+    track.push_back(bytes[0]);
+}
+
+void MidiFileWriter::setTimeSignature(uint8_t numerator, uint8_t denominator)
+{
+    uint8_t power = 0;
+    while((1 << power) < denominator) {
+        power++;
+    }
+    addDelta(tick);
+    uint8_t event[] = { 0xff, 0x58, 0x04, numerator, power, 24, 8 };
+    track.insert(track.end(), event, event + sizeof(event));
+}
+
+/**
+ * Set the tempo for the following periods, adds a tempo event when it has changed.
+ */
+void MidiFileWriter::setTempo(double beatsPerMinute, float beatType)
+{
+    double quartersPerBeat = 4.0 / beatType;
+    ticksPerFrame = beatsPerMinute * quartersPerBeat * TICKS_PER_QUARTER / (60.0 * sampleRate);
+    uint32_t microseconds = std::lround(60000000.0 / (beatsPerMinute * quartersPerBeat));
+    if(microseconds != tempo) {
+        tempo = microseconds;
+        addDelta(tick);
+        uint8_t event[] = { 0xff, 0x51, 0x03, (uint8_t)(tempo >> 16), (uint8_t)(tempo >> 8), (uint8_t)tempo };
+        track.insert(track.end(), event, event + sizeof(event));
+    }
+}
+
+/**
+ * Add an event at the given frame offset in the current period.
+ */
+void MidiFileWriter::addEvent(uint32_t frame, const uint8_t *data, size_t size)
+{
+    // only channel messages are written
+    if(!size || data[0] < 0x80 || data[0] >= 0xf0) {
+        return;
+    }
+    addDelta(tick + frame * ticksPerFrame);
+    track.insert(track.end(), data, data + size);
+}
+
+static void write16(FILE *file, uint16_t value)
+{
+    fputc(value >> 8, file);
+    fputc(value & 0xff, file);
+}
+
+static void write32(FILE *file, uint32_t value)
+{
+    write16(file, value >> 16);
+    write16(file, value & 0xffff);
+}
+
+/**
+ * Write the file, format 0 with one track.
+ */
+void MidiFileWriter::close()
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if(!file) {
+        throw std::runtime_error("cannot open " + path + " for writing");
+    }
+    // end of track
+    addDelta(tick);
+    uint8_t end[] = { 0xff, 0x2f, 0x00 };
+    track.insert(track.end(), end, end + sizeof(end));
+    // header
+    fwrite("MThd", 1, 4, file);
+    write32(file, 6);
+    write16(file, 0);
+    write16(file, 1);
+    write16(file, TICKS_PER_QUARTER);
+    // track
+    fwrite("MTrk", 1, 4, file);
+    write32(file, track.size());
+    fwrite(track.data(), 1, track.size(), file);
+    fclose(file);
+}
+
+}}
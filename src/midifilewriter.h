@@ -0,0 +1,56 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MIDIFILEWRITER_H
+#define MIDIFILEWRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bipscript {
+namespace midi {
+
+/**
+ * Collects MIDI events with frame timing and writes them as a single track standard MIDI file.
+ */
+class MidiFileWriter
+{
+    static const uint16_t TICKS_PER_QUARTER = 960;
+    std::string path;
+    uint32_t sampleRate;
+    std::vector<uint8_t> track;
+    double tick; // at the start of the current period
+    double ticksPerFrame;
+    uint32_t lastTick;
+    uint32_t tempo; // microseconds per quarter note
+    void addDelta(double eventTick);
+    void addVariableLength(uint32_t value);
+public:
+    MidiFileWriter(const std::string &path, uint32_t sampleRate) :
+        path(path), sampleRate(sampleRate), tick(0), ticksPerFrame(0), lastTick(0), tempo(0) {}
+    void setTimeSignature(uint8_t numerator, uint8_t denominator);
+    void setTempo(double beatsPerMinute, float beatType);
+    void addEvent(uint32_t frame, const uint8_t *data, size_t size);
+    void advance(uint32_t nframes) {
+        tick += nframes * ticksPerFrame;
+    }
+    void close();
+};
+
+}}
+
+#endif // MIDIFILEWRITER_H
@@ -18,32 +18,60 @@
 #include "midiport.h"
 #include "objectcollector.h"
 #include "audioengine.h"
+#include "scripthost.h"
 
 namespace bipscript {
 namespace midi {
 
+/**
+ * Find the events of the port buffer that fall in the current block.
+ *
+ * Runs in the process thread.
+ */
+void MidiInputConnection::process(jack_nframes_t nframes) {
+    AudioEngine &engine = AudioEngine::instance();
+    blockOffset = engine.getBlockOffset();
+    if(!blockOffset) {
+        buffer = engine.getPortBuffer(driverPort);
+        totalCount = driverPort->getMidiEventCount(buffer);
+        firstEvent = 0;
+    } else {
+        firstEvent += blockCount;
+    }
+    blockCount = 0;
+    jack_midi_event_t in_event;
+    while(firstEvent + blockCount < totalCount) {
+        driverPort->getMidiEvent(buffer, firstEvent + blockCount, in_event);
+        if(in_event.time >= blockOffset + nframes) {
+            break;
+        }
+        blockCount++;
+    }
+}
+
 Event *MidiInputConnection::getEvent(uint32_t i) {
     jack_midi_event_t in_event;
-    jack_midi_event_get(&in_event, buffer, i);
+    driverPort->getMidiEvent(buffer, firstEvent + i, in_event);
     lastEvent.unpack(in_event.buffer, in_event.size);
-    lastEvent.setFrameOffset(in_event.time);
+    lastEvent.setFrameOffset(in_event.time - blockOffset);
     return &lastEvent;
 }
 
 MidiInputPort *MidiInputPortCache::getMidiInputPort(const char *name, const char *connectTo)
 {
     // see if port already exists in map
-    int key = std::hash<std::string>()(name);
+    std::string fullName = ScriptHost::instance().portName(name);
+    int key = std::hash<std::string>()(fullName);
     MidiInputPort *port = findObject(key);
     if (!port) {
-        // create new jack port
-        jack_port_t *jackPort = AudioEngine::instance().registerMidiInputPort(name);
-        if(!jackPort) {
+        // create new system port
+        DriverPort *driverPort = AudioEngine::instance().registerMidiInputPort(fullName.c_str());
+        if(!driverPort) {
             std::string message = "Failed to register midi input port: ";
-            throw message + name;
+            throw message + fullName;
         }
         // add to map
-        port = new MidiInputPort(jackPort);
+        port = new MidiInputPort(driverPort);
         registerObject(key, port);
     }
     // auto-connect
@@ -55,22 +83,28 @@ MidiInputPort *MidiInputPortCache::getMidiInputPort(const char *name, const char
 
 MidiOutputPort::~MidiOutputPort()
 {
-    AudioEngine::instance().unregisterPort(jackPort);
+    AudioEngine::instance().unregisterPort(driverPort);
 }
 
 void MidiOutputPort::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t) {
 
-    // grab and clear the buffer for this port
-    void* port_buf = jack_port_get_buffer(jackPort, nframes);
-    jack_midi_clear_buffer(port_buf);
+    // grab the buffer for this port, clear it in the first block of the period
+    AudioEngine &engine = AudioEngine::instance();
+    jack_nframes_t offset = engine.getBlockOffset();
+    void* port_buf = engine.getPortBuffer(driverPort);
+    if(!offset) {
+        driverPort->clearMidiBuffer(port_buf);
+    }
     // schedule events that are waiting in the buffer
     Event* nextEvent = buffer.getNextEvent(rolling, pos, nframes);
     while(nextEvent) {
         long frame = nextEvent->getFrameOffset();
         size_t size = nextEvent->dataSize() + 1;
-        unsigned char* jackEvent = jack_midi_event_reserve(port_buf, frame >= 0 ? frame : 0, size);
-        nextEvent->pack(jackEvent);
-        ObjectCollector::scriptCollector().recycle(nextEvent);
+        unsigned char* jackEvent = driverPort->reserveMidiEvent(port_buf, (frame >= 0 ? frame : 0) + offset, size);
+        if(jackEvent) {
+            nextEvent->pack(jackEvent);
+        }
+        buffer.release(nextEvent);
         nextEvent = buffer.getNextEvent(rolling, pos, nframes);
     }
 }
@@ -78,25 +112,26 @@ void MidiOutputPort::doProcess(bool rolling, jack_position_t &pos, jack_nframes_
 void MidiOutputPort::systemConnect(const char *connection) {
     if(connected != connection) {
         if(connected.length() > 0) {
-            AudioEngine::instance().disconnectPort(jackPort, connected.c_str());
+            AudioEngine::instance().disconnectPort(driverPort, connected.c_str());
         }
-        AudioEngine::instance().connectPort(jackPort, connection);
+        AudioEngine::instance().connectPort(driverPort, connection);
         connected = connection;
     }
 }
 
 MidiOutputPort *MidiOutputPortCache::getMidiOutputPort(const char* portName, const char* connection)
 {
-    int key = std::hash<std::string>()(portName);
+    std::string fullName = ScriptHost::instance().portName(portName);
+    int key = std::hash<std::string>()(fullName);
     // see if port already exists in map
     MidiOutputPort *port = findObject(key);
     if(!port) {
         // create system port
-        jack_port_t *jackPort = AudioEngine::instance().registerMidiOutputPort(portName);
-        if(!jackPort) {
-            throw std::logic_error(std::string("Failed to register port ") + portName);
+        DriverPort *driverPort = AudioEngine::instance().registerMidiOutputPort(fullName.c_str());
+        if(!driverPort) {
+            throw std::logic_error(std::string("Failed to register port ") + fullName);
         }
-        port = new MidiOutputPort(jackPort);
+        port = new MidiOutputPort(driverPort);
         registerObject(key, port);
     }
     if(connection) {
@@ -22,8 +22,7 @@
 #include "midisink.h"
 #include "objectcache.h"
 
-#include <jack/jack.h>
-#include <jack/midiport.h>
+#include <jack/types.h>
 
 #include <map>
 #include <set>
@@ -33,21 +32,26 @@ namespace midi {
 
 class MidiInputConnection : public MidiConnection
 {
-    jack_port_t* jackPort;
+    DriverPort *driverPort;
     void *buffer;
     Event lastEvent;
+    // events of the current block
+    jack_nframes_t blockOffset;
+    uint32_t totalCount;
+    uint32_t firstEvent;
+    uint32_t blockCount;
 public:
-    MidiInputConnection(Source *source, jack_port_t *jackPort)
-        : MidiConnection(source), jackPort(jackPort) {}
-    void process(jack_nframes_t nframes) {
-        buffer = jack_port_get_buffer(jackPort, nframes);
-    }
+    MidiInputConnection(Source *source, DriverPort *driverPort)
+        : MidiConnection(source), driverPort(driverPort), buffer(0), blockOffset(0),
+          totalCount(0), firstEvent(0), blockCount(0) {}
+    void process(jack_nframes_t nframes);
     uint32_t getEventCount() {
-        return jack_midi_get_event_count(buffer);
+        return blockCount;
     }
     void systemConnect(const char *name) {
-        AudioEngine::instance().connectPort(name, jackPort);
+        AudioEngine::instance().connectPort(name, driverPort);
     }
+    DriverPort *getDriverPort() { return driverPort; }
     Event *getEvent(uint32_t i);
 };
 
@@ -55,8 +59,8 @@ class MidiInputPort : public Source
 {
     MidiInputConnection connection;
 public:
-    MidiInputPort(jack_port_t *jackPort)
-        : connection(this, jackPort) {}
+    MidiInputPort(DriverPort *driverPort)
+        : connection(this, driverPort) {}
     void systemConnect(const char *name) {
         connection.systemConnect(name);
     }
@@ -65,12 +69,14 @@ public:
     }
     unsigned int getMidiOutputCount() { return 1; }
     // Source interface
-    bool connectsTo(AbstractSource *) { return false; }
     void doProcess(bool, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t) {
         connection.process(nframes);
         fireMidiEvents(pos);
     }
     void reposition() {}
+    std::string getLabel() {
+        return std::string("Midi.SystemIn ") + connection.getDriverPort()->getName();
+    }
 };
 
 class MidiInputPortCache : public ProcessorCache<MidiInputPort>
@@ -88,17 +94,21 @@ public:
 
 class MidiOutputPort : public Processor, public Sink
 {
-    jack_port_t* jackPort;
+    DriverPort *driverPort;
     EventBuffer<Event> buffer;
     std::string connected;
 public:
-    MidiOutputPort(jack_port_t *jackPort) : jackPort(jackPort) {}
+    MidiOutputPort(DriverPort *driverPort) : driverPort(driverPort) {}
     ~MidiOutputPort();
     void systemConnect(const char *connection);
     void addMidiEvent(Event* evt)  { buffer.addEvent(evt);}
     // Processor interface
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
     void reposition() { buffer.recycleRemaining(); }
+    void relocate() { buffer.relocate(); }
+    std::string getLabel() {
+        return std::string("Midi.SystemOut ") + driverPort->getName();
+    }
 };
 
 class MidiOutputPortCache : public ProcessorCache<MidiOutputPort>
@@ -18,70 +18,122 @@
 #include "mixer.h"
 #include "scripttypes.h"
 #include "objectcollector.h"
+#include "simd.h"
 
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <stdexcept>
 
 namespace bipscript {
 namespace audio {
 
+// frames over which a controller change is spread
+const uint32_t CONTROL_RAMP_FRAMES = 64;
+// frames between points of an exponential ramp, linear in between
+const uint32_t EXPONENTIAL_RAMP_STEP = 64;
+// exponential ramps start and end here instead of at zero
+const float EXPONENTIAL_RAMP_FLOOR = 0.0001f; // -80 dB
+
+/**
+ * Gain after the given number of frames of the ramp, exponential ramps are linear in decibels.
+ *
+ * Runs in the process thread.
+ */
+float GainRamp::gainAt(uint32_t frame)
+{
+    if(frame >= length) {
+        return target;
+    }
+    float fraction = (float)frame / length;
+    if(!exponential) {
+        return start + (target - start) * fraction;
+    }
+    float from = start > EXPONENTIAL_RAMP_FLOOR ? start : EXPONENTIAL_RAMP_FLOOR;
+    float to = target > EXPONENTIAL_RAMP_FLOOR ? target : EXPONENTIAL_RAMP_FLOOR;
+    return from * std::exp(std::log(to / from) * fraction);
+}
+
 /**
- * Process a control connection: calls process on the underlying EventConnection and resets that
- * connection's eventCount and eventIndex for this period.
+ * Map a controller on any channel to the gain of an input and output pair and pass the
+ * rebuilt dispatch table to the process thread.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates MixerControlTable.
+ */
+void MixerControlConnection::addMapping(unsigned int cc, unsigned int input, unsigned int output)
+{
+    MixerControlTable::Mapping mapping;
+    mapping.channel = -1;
+    mapping.cc = cc;
+    mapping.target.input = input;
+    mapping.target.output = output;
+    mapping.curve = ControlCurve::linear(0, 1);
+    mappings.push_back(mapping);
+    // a table the process thread has not picked up yet is replaced
+    delete pendingTable.exchange(new MixerControlTable(mappings));
+}
+
+/**
+ * Process a control connection: picks up a rebuilt dispatch table and resets the eventCount
+ * and eventIndex of the underlying EventConnection for this period.
  *
  * Runs in the process thread.
  */
 void MixerControlConnection::process(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time)
 {
-    connection->getSource()->process(rolling, pos, nframes, time);
-    eventCount = connection->getEventCount();
+    MixerControlTable *fresh = pendingTable.exchange(0);
+    if(fresh) {
+        if(table) {
+            ObjectCollector::scriptCollector().recycle(table);
+        }
+        table = fresh;
+    }
+    eventCount = table ? connection->getEventCount() : 0;
     eventIndex = 0;
 }
 
 /**
- * Check the mappings vs the incoming events on this connection to see if there are any applicable
- * gain change events for this period, if so then make the change directly on the gain matrix.
+ * Look up the targets of the controller events on this connection up to the given frame and
+ * ramp their gains to the new values.
  *
  * Runs in the process thread.
  *
  */
-void MixerControlConnection::updateGains(jack_nframes_t frame, float **gain)
+void MixerControlConnection::updateGains(jack_nframes_t frame, Mixer &mixer)
 {
-    if(eventCount && eventIndex < eventCount) {
+    while(eventIndex < eventCount) {
         midi::Event *nextEvent = connection->getEvent(eventIndex);
-        while(nextEvent && nextEvent->getFrameOffset() == frame) {
-            if(nextEvent->matches(midi::Event::TYPE_CONTROL)) {
-                // check mappings
-                MixerControlMapping *mapping = mappings.getFirst();
-                while(mapping) {
-                    if(mapping->cc == nextEvent->getDatabyte1()) {
-                        gain[mapping->input][mapping->output] = (float) nextEvent->getDatabyte2() / 127;
-                    }
-                    mapping = mappings.getNext(mapping);
-                }
+        if(nextEvent->getFrameOffset() > frame) {
+            break;
+        }
+        if(nextEvent->matches(midi::Event::TYPE_CONTROL)) {
+            uint8_t channel = nextEvent->channel;
+            uint8_t cc = nextEvent->getDatabyte1();
+            uint8_t value = nextEvent->getDatabyte2() & 0x7f;
+            const MixerControlTable::Dispatch *end = table->end(channel, cc);
+            for(const MixerControlTable::Dispatch *dispatch = table->begin(channel, cc); dispatch != end; dispatch++) {
+                mixer.rampGain(dispatch->target.input, dispatch->target.output, dispatch->values[value],
+                               CONTROL_RAMP_FRAMES, false);
             }
-            // pull up next event
-            nextEvent = eventIndex < eventCount ? connection->getEvent(eventIndex++) : 0;
         }
+        eventIndex++;
     }
 }
 
 /**
- * Reset this MixerControlConnection.
+ * Frame of the next event on this connection, or the end of the period.
  *
- * Runs in process thread.
- *
- * Recycles MixerControlMapping objects.
+ * Runs in the process thread.
  */
-void MixerControlConnection::reposition()
+jack_nframes_t MixerControlConnection::nextChange(jack_nframes_t nframes)
 {
-    // recycle mappings
-    MixerControlMapping *mapping = mappings.getFirst();
-    while (mapping) {
-        MixerControlMapping *done = mapping;
-        mapping = mappings.pop();
-        ObjectCollector::scriptCollector().recycle(done);
+    if(eventIndex < eventCount) {
+        long offset = connection->getEvent(eventIndex)->getFrameOffset();
+        return offset < (long)nframes ? offset : nframes;
     }
+    return nframes;
 }
 
 /**
@@ -93,17 +145,27 @@ void MixerControlConnection::reposition()
  * Allocates AudioConnector, AudioConnection objects, routing and gain matrices.
  */
 Mixer::Mixer(unsigned int inputs, const unsigned int outputs)
-    : connectedInputs(0), audioInputCount(inputs),
-      audioOutputCount(outputs), newControlMappingsQueue(16), controlConnections(4) {
+    : routed(inputs * outputs, false), routeCount(0), publishedRouteCount(0), pendingRoutes(0), routes(0),
+      connectedInputs(0), audioInputCount(inputs), audioOutputCount(outputs), inputMeter(inputs),
+      outputMeter(outputs), meterInterval(0), meteredInterval(0), meterFrames(0), controlConnections(4) {
     audioInput = new AudioConnector[inputs];
     audioOutput = new AudioConnection*[outputs];
     for(uint32_t i = 0; i < audioOutputCount; i++) {
         audioOutput[i] = new AudioConnection(this);
     }
+    // one contiguous matrix, rows padded to whole vectors
+    gainStride = (outputs + 7) & ~7u;
+    void *matrix = 0;
+    if(posix_memalign(&matrix, 32, sizeof(float) * gainStride * (inputs ? inputs : 1))) {
+        throw std::bad_alloc();
+    }
+    gainMatrix = static_cast<float*>(matrix);
+    memset(gainMatrix, 0, sizeof(float) * gainStride * inputs);
     gain = new float*[inputs];
     for(unsigned int i = 0; i < inputs; i++) {
-        gain[i] = new float[outputs]();        
+        gain[i] = gainMatrix + i * gainStride;
     }
+    ramps = new GainRamp[inputs * outputs]();
 }
 
 /**
@@ -121,10 +183,11 @@ Mixer::~Mixer()
         delete audioOutput[i];
     }
     delete[] audioOutput;
-    for(unsigned int i = 0; i < audioInputCount; i++) {
-        delete[] gain[i];
-    }
     delete[] gain;
+    free(gainMatrix);
+    delete[] ramps;
+    delete pendingRoutes.load();
+    delete routes;
 }
 
 /**
@@ -178,6 +241,15 @@ void Mixer::connect(Source &source, ScriptArray &gainsArray)
             throw std::logic_error("each gain array entry should be a number or subarray");
         }
     }
+    // route inputs with a gain
+    for(uint32_t i = 0; i < sourceOutputCount; i++) {
+        for(uint32_t j = 0; j < audioOutputCount; j++) {
+            if(gain[connectedInputs + i][j]) {
+                addRoute(connectedInputs + i, j);
+            }
+        }
+    }
+    publishRoutes();
     // connect inputs
     for(unsigned int i = 0; i < sourceOutputCount; i++) {
         audioInput[connectedInputs++].setConnection(source.getAudioConnection(i), this);
@@ -208,7 +280,11 @@ void Mixer::connect(Source &source, float initialGain)
         uint32_t inputIndex = connectedInputs + inputCounter++ % inputOutputCount;
         uint32_t outputIndex = outputCounter++ % audioOutputCount;
         gain[inputIndex][outputIndex] = initialGain;
+        if(initialGain) {
+            addRoute(inputIndex, outputIndex);
+        }
     }
+    publishRoutes();
     // connect inputs
     for(unsigned int i = 0; i < inputOutputCount; i++) {
         audioInput[connectedInputs++].setConnection(source.getAudioConnection(i), this);
@@ -220,7 +296,7 @@ void Mixer::connect(Source &source, float initialGain)
  *
  * Runs in the script thread.
  *
- * Allocates MixerControlMapping, MixerControlConnection objects.
+ * Allocates MixerControlConnection objects and dispatch tables.
  */
 void Mixer::addGainController(midi::Source &source, unsigned int cc, unsigned int input, unsigned int output)
 {
@@ -240,10 +316,12 @@ void Mixer::addGainController(midi::Source &source, unsigned int cc, unsigned in
         mixerConnection = new MixerControlConnection(connection);
         controlConnectionMap[connection] = mixerConnection;
         controlConnections.add(mixerConnection);
+        AudioEngine::instance().graphChanged();
     }
     // push new mapping
-    MixerControlMapping *mapping = new MixerControlMapping(mixerConnection, cc, input - 1, output - 1);
-    while(!newControlMappingsQueue.push(mapping));
+    mixerConnection->addMapping(cc, input - 1, output - 1);
+    addRoute(input - 1, output - 1);
+    publishRoutes();
 }
 
 /**
@@ -257,6 +335,156 @@ void Mixer::scheduleGain(uint32_t input, uint32_t output, float gain, uint32_t b
     validateInputChannel(input);
     validateOutputChannel(output);
     gainEventBuffer.addEvent(new MixerGainEvent(input - 1, output - 1, gain, bar, position, division));
+    addRoute(input - 1, output - 1);
+    publishRoutes();
+}
+
+/**
+ * Schedule a gain change that ramps to the given gain over a length in the same division as
+ * the position, along a linear or exponential curve.
+ *
+ * Runs in script thread.
+ *
+ * Allocates MixerGainEvent.
+ */
+void Mixer::scheduleFade(uint32_t input, uint32_t output, float gain, uint32_t bar, uint32_t position,
+                         uint32_t division, uint32_t length, const char *curve)
+{
+    validateInputChannel(input);
+    validateOutputChannel(output);
+    bool exponential = false;
+    if(curve && std::string("exponential") == curve) {
+        exponential = true;
+    } else if(curve && std::string("linear") != curve) {
+        throw std::logic_error("fade curve should be linear or exponential");
+    }
+    gainEventBuffer.addEvent(new MixerGainEvent(input - 1, output - 1, gain, bar, position, division,
+                                                length, exponential));
+    addRoute(input - 1, output - 1);
+    publishRoutes();
+}
+
+/**
+ * Move the gain of a pair to the target over the given number of frames, from the gain it has
+ * now. A ramp of zero frames sets the gain right away.
+ *
+ * Runs in the process thread.
+ */
+void Mixer::rampGain(uint32_t input, uint32_t output, float target, uint32_t frames, bool exponential)
+{
+    GainRamp &ramp = ramps[input * audioOutputCount + output];
+    if(!frames) {
+        gain[input][output] = target;
+        ramp.active = false;
+        return;
+    }
+    ramp.start = gain[input][output];
+    ramp.target = target;
+    ramp.length = frames;
+    ramp.elapsed = 0;
+    ramp.exponential = exponential;
+    ramp.active = true;
+}
+
+/**
+ * Measure the levels of the inputs and outputs and publish them the given number of times
+ * per second, a rate of zero stops measuring.
+ *
+ * Runs in the script thread.
+ */
+void Mixer::meterRate(float rate)
+{
+    if(rate < 0) {
+        throw std::logic_error("meter rate cannot be negative");
+    }
+    jack_nframes_t interval = 0;
+    if(rate > 0) {
+        interval = AudioEngine::instance().getSampleRate() / rate;
+        interval = interval ? interval : 1;
+    }
+    meterInterval.store(interval);
+}
+
+/**
+ * Level of an input in decibels from the latest published snapshot, the measure is peak,
+ * rms or truePeak.
+ *
+ * Runs in the script thread.
+ */
+float Mixer::inputLevel(uint32_t input, const char *measure)
+{
+    validateInputChannel(input);
+    return selectLevel(inputMeter.read(input - 1), measure);
+}
+
+/**
+ * Level of an output in decibels from the latest published snapshot, the measure is peak,
+ * rms or truePeak.
+ *
+ * Runs in the script thread.
+ */
+float Mixer::outputLevel(uint32_t output, const char *measure)
+{
+    validateOutputChannel(output);
+    return selectLevel(outputMeter.read(output - 1), measure);
+}
+
+float Mixer::selectLevel(const LevelReading &reading, const char *measure)
+{
+    if(!measure || std::string("peak") == measure) {
+        return LevelMeter::decibels(reading.peak);
+    }
+    if(std::string("rms") == measure) {
+        return LevelMeter::decibels(reading.rms);
+    }
+    if(std::string("truePeak") == measure) {
+        return LevelMeter::decibels(reading.truePeak);
+    }
+    throw std::logic_error("level measure should be peak, rms or truePeak");
+}
+
+/**
+ * Mark an input and output pair as able to carry audio.
+ *
+ * Runs in the script thread.
+ */
+void Mixer::addRoute(uint32_t input, uint32_t output)
+{
+    if(!routed[input * audioOutputCount + output]) {
+        routed[input * audioOutputCount + output] = true;
+        routeCount++;
+    }
+}
+
+/**
+ * Build the routes from the marked pairs and pass them to the process thread, unless they
+ * have not changed since the last time. Routes are never removed, a pair whose gain drops to
+ * zero is skipped by the process thread.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates MixerRoutes.
+ */
+void Mixer::publishRoutes()
+{
+    if(routeCount == publishedRouteCount) {
+        return;
+    }
+    MixerRoutes *fresh = new MixerRoutes();
+    fresh->routes.reserve(routeCount);
+    for(uint32_t o = 0; o < audioOutputCount; o++) {
+        fresh->offsets.push_back(fresh->routes.size());
+        for(uint32_t i = 0; i < audioInputCount; i++) {
+            if(routed[i * audioOutputCount + o]) {
+                MixerRoutes::Route route = { i, &gain[i][o] };
+                fresh->routes.push_back(route);
+            }
+        }
+    }
+    fresh->offsets.push_back(fresh->routes.size());
+    publishedRouteCount = routeCount;
+    // a set the process thread has not picked up yet is replaced
+    delete pendingRoutes.exchange(fresh);
 }
 
 /**
@@ -269,22 +497,29 @@ void Mixer::scheduleGain(uint32_t input, uint32_t output, float gain, uint32_t b
 void Mixer::restore()
 {
     controlConnectionMap.clear();
+    meterInterval.store(0);
+    // inputs dropped by the reposition reconnect from the first one
+    for(uint32_t i = connectedInputs.load(); i < audioInputCount; i++) {
+        audioInput[i].clearConnection(this);
+    }
 }
 
 /**
- * Checks connection path to a source.
+ * Reports connected audio inputs and control connections.
  *
  * Runs in script thread.
  */
-bool Mixer::connectsTo(AbstractSource *source) {
-    // TODO: event inputs
-    // audio inputs
+void Mixer::getSources(std::vector<Processor*> &sources)
+{
     for(uint32_t i = 0; i < connectedInputs; i++) {
-        if(audioInput[i].getConnection()->getSource()->connectsTo(source)) {
-            return true;
+        AudioConnection *connection = audioInput[i].getConnection();
+        if(connection) {
+            sources.push_back(connection->getSource());
         }
     }
-    return false;
+    for(auto it = controlConnectionMap.begin(); it != controlConnectionMap.end(); it++) {
+        sources.push_back(it->first->getSource());
+    }
 }
 
 /**
@@ -296,23 +531,34 @@ bool Mixer::connectsTo(AbstractSource *source) {
  */
 void Mixer::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time)
 {    
-    // pull in new control mappings
-    MixerControlMapping *freshMapping;
-    while(newControlMappingsQueue.pop(freshMapping)) {
-        freshMapping->connection->addMapping(freshMapping);
+    // pick up changed routes, the old ones are deleted outside this thread
+    MixerRoutes *freshRoutes = pendingRoutes.exchange(0);
+    if(freshRoutes) {
+        if(routes) {
+            ObjectCollector::scriptCollector().recycle(routes);
+        }
+        routes = freshRoutes;
     }
 
-    // get audio from input connections
-    float *audio[connectedInputs];
-    for(unsigned int i = 0; i < connectedInputs; i++) {
+    // get audio from input connections, silent and unconnected inputs are skipped
+    unsigned int inputs = connectedInputs;
+    float *audio[audioInputCount];
+    bool active[audioInputCount];
+    for(unsigned int i = 0; i < audioInputCount; i++) {
+        active[i] = false;
+    }
+    for(unsigned int i = 0; i < inputs; i++) {
         AudioConnection *conn = audioInput[i].getConnection();
-        conn->getSource()->process(rolling, pos, nframes, time);
-        audio[i] = conn->getAudio();
+        audio[i] = audioInput[i].readAudio(nframes);
+        // a delayed input can still be sounding after its source went silent
+        active[i] = !conn->isSilent() || audioInput[i].isDelayed();
     }
+    bool written[audioOutputCount];
 
     // zero out all output channels
     for(unsigned int i = 0; i < audioOutputCount; i++) {
         memset(audioOutput[i]->getAudio(), 0, nframes * sizeof(float));
+        written[i] = false;
     }
 
     // process control connections
@@ -322,39 +568,184 @@ void Mixer::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes
         connection = controlConnections.getNext(connection);
     }
 
+    // level meters start over when their rate changes
+    jack_nframes_t interval = meterInterval.load();
+    if(interval != meteredInterval) {
+        inputMeter.clear();
+        outputMeter.clear();
+        meterFrames = 0;
+        meteredInterval = interval;
+    }
+
     // grab first gain event
     MixerGainEvent *event = gainEventBuffer.getNextEvent(rolling, pos, nframes);
 
-    // loop over frames
-    for(jack_nframes_t frame = 0; frame < nframes; frame++) {
+    // mix in segments between gain changes
+    jack_nframes_t frame = 0;
+    while(frame < nframes) {
 
-        // check for gain changes via controllers
+        // apply gain changes via controllers, find the next one
+        jack_nframes_t end = nframes;
         MixerControlConnection *connection = this->controlConnections.getFirst();
         while(connection) {
-            connection->updateGains(frame, gain);
+            connection->updateGains(frame, *this);
+            jack_nframes_t next = connection->nextChange(nframes);
+            end = next < end ? next : end;
             connection = controlConnections.getNext(connection);
         }
 
-        // check for gain changes via scheduled events
-        while(event && event->getFrameOffset() == frame) {
-            // update gain
-            gain[event->getInput()][event->getOutput()] = event->getValue();
+        // apply gain changes via scheduled events
+        while(event && event->getFrameOffset() <= (long)frame) {
+            // update gain, over the ramp of the event if it has one
+            rampGain(event->getInput(), event->getOutput(), event->getValue(),
+                     event->getRampFrames(pos), event->isExponential());
             // recycle and get next buffer event
-            ObjectCollector::scriptCollector().recycle(event);
+            gainEventBuffer.release(event);
             event = gainEventBuffer.getNextEvent(rolling, pos, nframes);
         }
+        if(event && event->getFrameOffset() < (long)end) {
+            end = event->getFrameOffset();
+        }
 
-        // loop over inputs
-        for(unsigned int i = 0; i < connectedInputs; i++) {
-            // loop over outputs
-            for(unsigned int o = 0; o < audioOutputCount; o++) {
-                if(gain[i][o]) {
-                    float *buffer = audioOutput[o]->getAudio();
-                    buffer[frame] += audio[i][frame] * gain[i][o];
-                }
+        mixSegment(audio, active, written, frame, end, interval != 0);
+        frame = end;
+    }
+
+    // publish the levels once per interval
+    if(interval) {
+        meterFrames += nframes;
+        if(meterFrames >= interval) {
+            inputMeter.publish(meterFrames);
+            outputMeter.publish(meterFrames);
+            meterFrames = 0;
+        }
+    }
+
+    // flag outputs for downstream processors
+    for(unsigned int o = 0; o < audioOutputCount; o++) {
+        if(written[o]) {
+            audioOutput[o]->detectState(nframes);
+        } else {
+            audioOutput[o]->setState(AudioConnection::SILENT);
+        }
+    }
+}
+
+/**
+ * Mix the active inputs into the outputs over part of the period with constant gains, only
+ * the routes of each output are visited and routes with zero gain are skipped.
+ *
+ * When metered the levels are added in the same pass: each input where it is first mixed and
+ * each output where the last input is mixed into it, ramps are mixed before the constant
+ * gains for this. Only inputs and outputs that are not mixed that way are read again.
+ *
+ * Runs in the process thread.
+ */
+void Mixer::mixSegment(float **audio, bool *active, bool *written, jack_nframes_t start, jack_nframes_t end,
+                       bool metered)
+{
+    jack_nframes_t frames = end - start;
+    bool measured[audioInputCount];
+    for(unsigned int i = 0; i < audioInputCount; i++) {
+        measured[i] = false;
+    }
+    for(unsigned int o = 0; routes && o < audioOutputCount; o++) {
+        float *output = audioOutput[o]->getAudio() + start;
+        uint32_t first = routes->offsets[o];
+        uint32_t count = routes->offsets[o + 1] - first;
+        uint32_t mixing[count ? count : 1];
+        uint32_t mixingCount = 0;
+        bool ramped = false;
+        for(uint32_t r = first; r < first + count; r++) {
+            const MixerRoutes::Route &route = routes->routes[r];
+            if(ramps[route.input * audioOutputCount + o].active) {
+                // the ramp moves on while the input is silent
+                mixRamp(active[route.input] ? output : 0, active[route.input] ? audio[route.input] + start : 0,
+                        route.input * audioOutputCount + o, frames);
+                ramped = ramped || active[route.input];
+            }
+            else if(*route.gain && active[route.input]) {
+                mixing[mixingCount++] = r;
+            }
+        }
+        for(uint32_t m = 0; m < mixingCount; m++) {
+            const MixerRoutes::Route &route = routes->routes[mixing[m]];
+            const float *input = audio[route.input] + start;
+            simd::Levels *inputLevels = metered && !measured[route.input] ?
+                        &inputMeter.getLevels(route.input) : 0;
+            simd::Levels *outputLevels = metered && m + 1 == mixingCount ? &outputMeter.getLevels(o) : 0;
+            if(inputLevels && outputLevels) {
+                simd::multiplyAddMeasure<true, true>(output, input, *route.gain, frames, inputLevels, outputLevels);
+            } else if(inputLevels) {
+                simd::multiplyAddMeasure<true, false>(output, input, *route.gain, frames, inputLevels, 0);
+            } else if(outputLevels) {
+                simd::multiplyAddMeasure<false, true>(output, input, *route.gain, frames, 0, outputLevels);
+            } else {
+                simd::multiplyAdd(output, input, *route.gain, frames);
+            }
+            measured[route.input] = measured[route.input] || metered;
+        }
+        written[o] = written[o] || ramped || mixingCount;
+        if(metered && !mixingCount) {
+            if(ramped) {
+                simd::measure(outputMeter.getLevels(o), output, frames);
+            } else {
+                simd::measureSilence(outputMeter.getLevels(o), frames);
             }
         }
     }
+    if(!metered) {
+        return;
+    }
+    for(unsigned int o = 0; !routes && o < audioOutputCount; o++) {
+        simd::measureSilence(outputMeter.getLevels(o), frames);
+    }
+    // inputs that were muted or only ramped
+    for(unsigned int i = 0; i < audioInputCount; i++) {
+        if(measured[i]) {
+            continue;
+        }
+        if(active[i]) {
+            simd::measure(inputMeter.getLevels(i), audio[i] + start, frames);
+        } else {
+            simd::measureSilence(inputMeter.getLevels(i), frames);
+        }
+    }
+}
+
+/**
+ * Mix one input into an output along the ramp of the pair and move the ramp on, exponential
+ * ramps are followed in linear steps. Without an output only the ramp moves on.
+ *
+ * Runs in the process thread.
+ */
+void Mixer::mixRamp(float *output, const float *input, uint32_t pair, jack_nframes_t frames)
+{
+    GainRamp &ramp = ramps[pair];
+    float &current = gain[pair / audioOutputCount][pair % audioOutputCount];
+    jack_nframes_t frame = 0;
+    while(frame < frames && ramp.active) {
+        uint32_t remaining = ramp.length - ramp.elapsed;
+        uint32_t step = frames - frame < remaining ? frames - frame : remaining;
+        if(ramp.exponential && step > EXPONENTIAL_RAMP_STEP) {
+            step = EXPONENTIAL_RAMP_STEP;
+        }
+        float from = ramp.gainAt(ramp.elapsed);
+        float to = ramp.gainAt(ramp.elapsed + step);
+        if(output) {
+            simd::multiplyAddRamp(output + frame, input + frame, from, (to - from) / step, step);
+        }
+        ramp.elapsed += step;
+        current = to;
+        frame += step;
+        if(ramp.elapsed >= ramp.length) {
+            ramp.active = false;
+        }
+    }
+    // rest of the segment at the target
+    if(output && frame < frames && current) {
+        simd::multiplyAdd(output + frame, input + frame, current, frames - frame);
+    }
 }
 
 /**
@@ -369,16 +760,16 @@ void Mixer::reposition()
     // recycle control connection
     MixerControlConnection *connection = controlConnections.getFirst();
     while(connection) {
-        connection->reposition();
         MixerControlConnection *done = connection;
         connection = controlConnections.pop();
         ObjectCollector::scriptCollector().recycle(done);
     }
     // gain event buffer
     gainEventBuffer.recycleRemaining();
-    // control connections
-    MixerControlMapping *mapping;
-    while(newControlMappingsQueue.pop(mapping)) {}
+    // ramps stop where they are
+    for(uint32_t i = 0; i < audioInputCount * audioOutputCount; i++) {
+        ramps[i].active = false;
+    }
     connectedInputs = 0;
 }
 
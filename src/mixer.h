@@ -22,12 +22,13 @@
 #include "listable.h"
 #include "eventbuffer.h"
 #include "objectcache.h"
+#include "controltable.h"
+#include "levelmeter.h"
 
 #include <iostream>
-#include <boost/lockfree/spsc_queue.hpp>
 #include <map>
+#include <vector>
 
-using boost::lockfree::spsc_queue;
 using std::map;
 
 namespace bipscript {
@@ -36,44 +37,63 @@ class ScriptArray;
 
 namespace audio {
 
-class MixerControlConnection;
+class Mixer;
 
-struct MixerControlMapping : public Listable
+struct MixerControlTarget
 {
-    MixerControlConnection *connection;
-    unsigned int cc;
-    unsigned int input;
-    unsigned int output;
-    MixerControlMapping(MixerControlConnection *connection, unsigned int cc, unsigned int input, unsigned int output) :
-        connection(connection), cc(cc), input(input), output(output) {
-    }
+    uint32_t input;
+    uint32_t output;
 };
 
+typedef ControlTable<MixerControlTarget> MixerControlTable;
+
 class MixerControlConnection : public Listable
 {
-    List<MixerControlMapping> mappings;
     midi::MidiConnection *connection;
+    std::vector<MixerControlTable::Mapping> mappings; // script thread
+    std::atomic<MixerControlTable*> pendingTable;
+    MixerControlTable *table; // process thread
     u_int32_t eventCount;
     u_int32_t eventIndex;
 public:
     MixerControlConnection(midi::MidiConnection *connection) :
-        connection(connection) {}
-    void addMapping(MixerControlMapping *mapping) {
-        mappings.add(mapping);
+        connection(connection), pendingTable(0), table(0), eventCount(0), eventIndex(0) {}
+    ~MixerControlConnection() {
+        delete pendingTable.load();
+        delete table;
     }
+    midi::MidiConnection *getConnection() { return connection; }
+    void addMapping(unsigned int cc, unsigned int input, unsigned int output);
     void process(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
-    void updateGains(jack_nframes_t frame, float **gains);
-    void reposition();
+    void updateGains(jack_nframes_t frame, Mixer &mixer);
+    jack_nframes_t nextChange(jack_nframes_t nframes);
 };
 
 class MixerGainEvent : public Event {
     uint32_t input;
     uint32_t output;
     float value;
+    Position rampEnd; // same as the event for a step
+    bool exponential;
 public:
     MixerGainEvent(uint32_t input, uint32_t output, float value,
                    uint32_t bar, uint32_t position, uint32_t division) :
-        Event(bar, position, division), input(input), output(output), value(value) {}
+        Event(bar, position, division), input(input), output(output), value(value),
+        rampEnd(bar, position, division), exponential(false) {}
+    MixerGainEvent(uint32_t input, uint32_t output, float value,
+                   uint32_t bar, uint32_t position, uint32_t division, uint32_t length, bool exponential) :
+        Event(bar, position, division), input(input), output(output), value(value),
+        rampEnd(Position(bar, position, division) + Duration(0, length, division)), exponential(exponential) {}
+    /**
+     * Frames from the event to the end of its ramp at the given transport position.
+     */
+    long getRampFrames(jack_position_t &pos) {
+        long frames = rampEnd.calculateFrameOffset(pos) - getFrameOffset();
+        return frames > 0 ? frames : 0;
+    }
+    bool isExponential() {
+        return exponential;
+    }
     uint32_t getInput() {
         return input;
     }
@@ -86,9 +106,48 @@ public:
 };
 
 
+/**
+ * Input and output pairs of a mixer that can carry audio, grouped by output. The gains are
+ * read through the routes so controllers and scheduled changes still apply.
+ *
+ * Built in the script thread, read by the process thread.
+ */
+struct MixerRoutes : public Listable
+{
+    struct Route {
+        uint32_t input;
+        const float *gain;
+    };
+    std::vector<uint32_t> offsets; // first route of each output, one extra at the end
+    std::vector<Route> routes;
+};
+
+/**
+ * Gain change of one input and output pair spread over a number of frames.
+ */
+struct GainRamp
+{
+    float start;
+    float target;
+    uint32_t length;
+    uint32_t elapsed;
+    bool exponential;
+    bool active;
+    float gainAt(uint32_t frame);
+};
+
 class Mixer : public Source
 {
+    float *gainMatrix; // aligned rows of gainStride floats, one per input
+    uint32_t gainStride;
     float **gain;   // TODO: threadsafe?
+    // routes
+    GainRamp *ramps; // per input and output pair, process thread
+    std::vector<bool> routed; // script thread
+    uint32_t routeCount;
+    uint32_t publishedRouteCount;
+    std::atomic<MixerRoutes*> pendingRoutes;
+    MixerRoutes *routes; // process thread
     // audio inputs
     std::atomic<unsigned int> connectedInputs;
     const unsigned int audioInputCount;
@@ -96,9 +155,14 @@ class Mixer : public Source
     // audio outputs
     const unsigned int audioOutputCount;
     AudioConnection **audioOutput;
+    // level meters
+    LevelMeter inputMeter;
+    LevelMeter outputMeter;
+    std::atomic<jack_nframes_t> meterInterval; // frames between snapshots, zero when off
+    jack_nframes_t meteredInterval; // process thread
+    jack_nframes_t meterFrames; // process thread
     // control connections
     map<midi::MidiConnection*,MixerControlConnection*> controlConnectionMap;
-    spsc_queue<MixerControlMapping*> newControlMappingsQueue;
     QueueList<MixerControlConnection> controlConnections;
     EventBuffer<MixerGainEvent> gainEventBuffer;
 public:
@@ -111,15 +175,47 @@ public:
     }
     void addGainController(midi::Source &source, unsigned int cc, unsigned int input, unsigned int output);
     void scheduleGain(uint32_t input, uint32_t output, float gain, uint32_t bar, uint32_t position, uint32_t division);
+    void scheduleFade(uint32_t input, uint32_t output, float gain, uint32_t bar, uint32_t position, uint32_t division,
+                      uint32_t length, const char *curve);
+    void scheduleFade(uint32_t input, uint32_t output, float gain, uint32_t bar, uint32_t position, uint32_t division,
+                      uint32_t length) {
+        scheduleFade(input, output, gain, bar, position, division, length, 0);
+    }
+    void rampGain(uint32_t input, uint32_t output, float target, uint32_t frames, bool exponential);
+    void meterRate(float rate);
+    float inputLevel(uint32_t input, const char *measure);
+    float inputLevel(uint32_t input) {
+        return inputLevel(input, 0);
+    }
+    float outputLevel(uint32_t output, const char *measure);
+    float outputLevel(uint32_t output) {
+        return outputLevel(output, 0);
+    }
+    LevelReading getInputLevels(uint32_t input) { return inputMeter.read(input); }
+    LevelReading getOutputLevels(uint32_t output) { return outputMeter.read(output); }
+    unsigned int getAudioInputCount() { return audioInputCount; }
     void restore();
     // Source interface
-    bool connectsTo(AbstractSource *source);
+    void getSources(std::vector<Processor*> &sources);
+    void getAudioInputs(std::vector<AudioConnector*> &inputs) {
+        for(unsigned int i = 0; i < connectedInputs.load(); i++) {
+            inputs.push_back(&audioInput[i]);
+        }
+    }
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
+    std::string getLabel() { return "Audio.Mixer"; }
     void reposition();
+    void relocate() { gainEventBuffer.relocate(); }
     // AudioSource interface
     unsigned int getAudioOutputCount() { return audioOutputCount; }
     AudioConnection *getAudioConnection(unsigned int index) { return audioOutput[index]; }
 private:
+    void addRoute(uint32_t input, uint32_t output);
+    void publishRoutes();
+    void mixSegment(float **audio, bool *active, bool *written, jack_nframes_t start, jack_nframes_t end,
+                    bool metered);
+    static float selectLevel(const LevelReading &reading, const char *measure);
+    void mixRamp(float *output, const float *input, uint32_t route, jack_nframes_t frames);
     void validateInputChannel(uint32_t input);
     void validateOutputChannel(uint32_t output);
 };
@@ -19,35 +19,66 @@
 
 namespace bipscript {
 
-// called by process thread to recycle a single event
+/**
+ * Hand off a single object, held back when the queue is full.
+ *
+ * Runs in the producing thread, never allocates.
+ */
 void ObjectCollector::recycle(Listable *evt) {
-    // try to push to queue
-    if(!objectQueue.push(evt)) {
-        // q is full, add to waiting list
+    uint16_t worker = WorkerIndex::current();
+    if(worker) {
+        workerLists[worker].add(evt);
+        return;
+    }
+    if(waitingList.getFirst() || !objectQueue.bounded_push(evt)) {
         waitingList.add(evt);
     }
 }
 
-// called by process thread to recycle a list of events
+/**
+ * Hand off a list of objects, they wait for the next update.
+ *
+ * Runs in the producing thread.
+ */
 void ObjectCollector::recycleAll(List<Listable> &list) {
-    // append rest to waiting list
-    waitingList.addAll(list);
-    // push to queue as many as we can
-    Listable *next = waitingList.getFirst();
-    while(next && objectQueue.push(next)) {
-        next = waitingList.pop();
+    if(!list.getFirst()) {
+        return;
     }
+    uint16_t worker = WorkerIndex::current();
+    (worker ? workerLists[worker] : waitingList).addAll(list);
 }
 
-// called by process thread to shrink the waiting list
-void ObjectCollector::update() {
+/**
+ * Take over the objects held by the process workers, they wait for the next update.
+ *
+ * Runs in the process thread after the workers have joined.
+ */
+void ObjectCollector::gather(uint16_t workers) {
+    for(uint16_t worker = 1; worker <= workers; worker++) {
+        if(workerLists[worker].getFirst()) {
+            waitingList.addAll(workerLists[worker]);
+            workerLists[worker].clear();
+        }
+    }
+}
+
+/**
+ * Hand off at most the given number of held back objects.
+ *
+ * Runs in the producing thread.
+ */
+void ObjectCollector::update(uint32_t budget) {
     Listable *waiting = waitingList.getFirst();
-    while(waiting && objectQueue.push(waiting)) {
+    while(waiting && budget-- && objectQueue.bounded_push(waiting)) {
         waiting = waitingList.pop();
     }
 }
 
-// called by script thread to delete available events
+/**
+ * Delete all objects handed off so far.
+ *
+ * Runs in the housekeeping thread.
+ */
 void ObjectCollector::free() {
     Listable *event;
     while (objectQueue.pop(event)) {
@@ -55,4 +86,16 @@ void ObjectCollector::free() {
     }
 }
 
-}
\ No newline at end of file
+/**
+ * Delete at most the given number of objects handed off so far.
+ *
+ * Runs in the process thread.
+ */
+void ObjectCollector::free(uint32_t budget) {
+    Listable *event;
+    while (budget-- && objectQueue.pop(event)) {
+        delete event;
+    }
+}
+
+}
@@ -18,19 +18,30 @@
 #define OBJECTCOLLECTOR_H
 
 #include "listable.h"
+#include "workerindex.h"
 #include <boost/lockfree/queue.hpp>
 
 namespace bipscript {
 
+/**
+ * Hands objects from the thread that is done with them to the thread that deletes them.
+ *
+ * The script collector takes objects from the process thread and is emptied by the
+ * housekeeping thread, the process collector takes objects allocated from the process pool
+ * back to the process thread.
+ */
 class ObjectCollector
 {
-    boost::lockfree::queue<Listable*> objectQueue; // script thread -> collector thread
+    boost::lockfree::queue<Listable*> objectQueue; // producer -> deleting thread
     List<Listable> waitingList;
+    List<Listable> workerLists[WorkerIndex::MAX_WORKERS]; // held by each process worker
     // singleton
     ObjectCollector() : objectQueue(4096) {}
     ObjectCollector(ObjectCollector const&);
     void operator=(ObjectCollector const&);
 public:
+    // objects handed off or deleted per period by the process thread
+    static const uint32_t PERIOD_BUDGET = 256;
     static ObjectCollector &scriptCollector() {
         static ObjectCollector instance;
         return instance;
@@ -41,8 +52,10 @@ public:
     }
     void recycle(Listable *collectable);
     void recycleAll(List<Listable> &list);
-    void update();
+    void gather(uint16_t workers);
+    void update(uint32_t budget);
     void free();
+    void free(uint32_t budget);
 };
 
 }
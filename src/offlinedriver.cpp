@@ -0,0 +1,255 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "offlinedriver.h"
+#include "audioengine.h"
+#include "transportmaster.h"
+
+#include <cstring>
+
+namespace bipscript {
+
+MemoryPort::MemoryPort(const char *name, Type type, jack_nframes_t bufferSize)
+    : name(name), type(type), audio(0), eventCount(0), events(0), data(0), dataSize(0)
+{
+    if(type == AUDIO_INPUT || type == AUDIO_OUTPUT) {
+        audio = new float[bufferSize]();
+    } else {
+        events = new jack_midi_event_t[MIDI_EVENT_CAPACITY];
+        data = new jack_midi_data_t[MIDI_DATA_CAPACITY];
+    }
+}
+
+MemoryPort::~MemoryPort()
+{
+    delete[] audio;
+    delete[] events;
+    delete[] data;
+}
+
+/**
+ * Append an event to the MIDI buffer, events must be reserved in time order.
+ *
+ * Runs in the process thread.
+ */
+jack_midi_data_t *MemoryPort::reserveMidiEvent(void *, jack_nframes_t time, size_t size)
+{
+    if(eventCount == MIDI_EVENT_CAPACITY || dataSize + size > MIDI_DATA_CAPACITY) {
+        return 0;
+    }
+    jack_midi_event_t &event = events[eventCount++];
+    event.time = time;
+    event.size = size;
+    event.buffer = data + dataSize;
+    dataSize += size;
+    return event.buffer;
+}
+
+void *run_offline_driver(void *arg)
+{
+    static_cast<OfflineDriver*>(arg)->run();
+    return 0;
+}
+
+OfflineDriver::OfflineDriver(jack_nframes_t sampleRate, jack_nframes_t bufferSize)
+    : sampleRate(sampleRate), bufferSize(bufferSize), timebase(0), frameTime(0),
+      state(JackTransportStopped), newPosition(true), syncing(false), startRequested(false),
+      stopRequested(false), locateRequested(false), locateFrame(0), started(false), stopped(false)
+{
+    // BBT for scripts that do not create a transport master, never deleted since
+    // deleting a master releases the timebase
+    defaultMaster = new transport::Master(120, 4, 4);
+    std::memset(&position, 0, sizeof(position));
+    position.frame_rate = sampleRate;
+}
+
+int OfflineDriver::activate(const char *)
+{
+    AudioEngine &engine = AudioEngine::instance();
+    engine.setSampleRate(sampleRate);
+    engine.setBufferSize(bufferSize);
+    engine.startWorkers();
+    if(pthread_create(&thread, 0, run_offline_driver, this)) {
+        return 1;
+    }
+    started = true;
+    return 0;
+}
+
+void OfflineDriver::shutdown()
+{
+    stopped.store(true);
+    if(started) {
+        pthread_join(thread, 0);
+        started = false;
+    }
+}
+
+/**
+ * Apply pending transport requests, run one period and advance the clock.
+ *
+ * Returns whether the transport rolled during the period, the position it ran at is copied
+ * to the given position.
+ *
+ * Runs in the driver thread.
+ */
+bool OfflineDriver::runPeriod(jack_position_t &pos)
+{
+    AudioEngine &engine = AudioEngine::instance();
+    jack_transport_state_t syncState;
+    bool sync;
+    {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        if(locateRequested) {
+            position.frame = locateFrame;
+            newPosition = true;
+            syncing = true;
+            if(state == JackTransportRolling) {
+                state = JackTransportStarting;
+            }
+            locateRequested = false;
+        }
+        if(startRequested) {
+            if(state == JackTransportStopped) {
+                state = JackTransportStarting;
+                syncing = true;
+            }
+            startRequested = false;
+        }
+        if(stopRequested) {
+            state = JackTransportStopped;
+            stopRequested = false;
+        }
+        if(newPosition) {
+            (timebase ? timebase : defaultMaster)->setTime(state, bufferSize, &position, 1);
+            newPosition = false;
+        }
+        sync = syncing;
+        syncState = state;
+        pos = position;
+    }
+
+    // slow sync, the engine may need several periods to reposition
+    if(sync && engine.sync(syncState, &pos)) {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        syncing = false;
+        if(state == JackTransportStarting) {
+            state = JackTransportRolling;
+        }
+    }
+
+    bool rolling;
+    {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        rolling = state == JackTransportRolling;
+        pos = position;
+    }
+    engine.process(bufferSize);
+    frameTime.fetch_add(bufferSize);
+
+    // timebase computes the position of the next period
+    if(rolling) {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        position.frame += bufferSize;
+        (timebase ? timebase : defaultMaster)->setTime(state, bufferSize, &position, 0);
+    }
+    return rolling;
+}
+
+/**
+ * Advance the clock and a rolling transport by one period without running the engine, as
+ * when the server misses a deadline.
+ *
+ * Runs in the driver thread.
+ */
+void OfflineDriver::skipPeriod()
+{
+    frameTime.fetch_add(bufferSize);
+    std::lock_guard<std::mutex> lock(transportMutex);
+    if(state == JackTransportRolling) {
+        position.frame += bufferSize;
+        (timebase ? timebase : defaultMaster)->setTime(state, bufferSize, &position, 0);
+    }
+}
+
+/**
+ * True when the transport is stopped rather than rolling or waiting for sync.
+ */
+bool OfflineDriver::transportStopped()
+{
+    std::lock_guard<std::mutex> lock(transportMutex);
+    return state == JackTransportStopped;
+}
+
+bool OfflineDriver::queryTransport(jack_position_t &pos)
+{
+    std::lock_guard<std::mutex> lock(transportMutex);
+    pos = position;
+    return state == JackTransportRolling;
+}
+
+void OfflineDriver::transportStart()
+{
+    std::lock_guard<std::mutex> lock(transportMutex);
+    startRequested = true;
+    stopRequested = false;
+}
+
+void OfflineDriver::transportStop()
+{
+    std::lock_guard<std::mutex> lock(transportMutex);
+    stopRequested = true;
+    startRequested = false;
+}
+
+void OfflineDriver::transportLocate(jack_nframes_t frame)
+{
+    std::lock_guard<std::mutex> lock(transportMutex);
+    locateRequested = true;
+    locateFrame = frame;
+}
+
+/**
+ * Use the given master for BBT from the next period on, the new master recomputes BBT for
+ * the current frame.
+ */
+bool OfflineDriver::setTimebaseMaster(transport::Master *master)
+{
+    std::lock_guard<std::mutex> lock(transportMutex);
+    timebase = master;
+    newPosition = true;
+    return true;
+}
+
+DriverPort *OfflineDriver::registerPort(const char *name, DriverPort::Type type)
+{
+    MemoryPort *port = new MemoryPort(name, type, bufferSize);
+    std::lock_guard<std::mutex> lock(portMutex);
+    ports.insert(port);
+    return port;
+}
+
+void OfflineDriver::unregisterPort(DriverPort *port)
+{
+    MemoryPort *memoryPort = static_cast<MemoryPort*>(port);
+    std::lock_guard<std::mutex> lock(portMutex);
+    portRemoved(memoryPort);
+    ports.erase(memoryPort);
+    delete memoryPort;
+}
+
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OFFLINEDRIVER_H
+#define OFFLINEDRIVER_H
+
+#include "audiodriver.h"
+
+#include <jack/jack.h>
+#include <pthread.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace bipscript {
+
+/**
+ * System port with its buffer in memory, for drivers without a server.
+ */
+class MemoryPort : public DriverPort
+{
+    static const uint32_t MIDI_EVENT_CAPACITY = 1024;
+    static const size_t MIDI_DATA_CAPACITY = 16384;
+    std::string name;
+    Type type;
+    float *audio;
+    uint32_t eventCount;
+    jack_midi_event_t *events;
+    jack_midi_data_t *data;
+    size_t dataSize;
+public:
+    MemoryPort(const char *name, Type type, jack_nframes_t bufferSize);
+    ~MemoryPort();
+    Type getType() { return type; }
+    float *getAudio() { return audio; }
+    const char *getName() { return name.c_str(); }
+    void *getBuffer(jack_nframes_t) {
+        return audio ? static_cast<void*>(audio) : static_cast<void*>(this);
+    }
+    uint32_t getMidiEventCount(void *) {
+        return eventCount;
+    }
+    void getMidiEvent(void *, uint32_t index, jack_midi_event_t &event) {
+        event = events[index];
+    }
+    void clearMidiBuffer(void *) {
+        eventCount = 0;
+        dataSize = 0;
+    }
+    jack_midi_data_t *reserveMidiEvent(void *, jack_nframes_t time, size_t size);
+};
+
+/**
+ * Driver base for running the engine without a server: keeps its own clock and transport and
+ * runs periods from a driver thread as fast as the subclass asks for them.
+ *
+ * The transport follows JACK semantics, including slow sync on start and relocation.
+ */
+class OfflineDriver : public AudioDriver
+{
+    jack_nframes_t sampleRate;
+    jack_nframes_t bufferSize;
+    transport::Master *defaultMaster;
+    transport::Master *timebase;
+    std::atomic<jack_nframes_t> frameTime;
+    // transport, guarded by the mutex
+    std::mutex transportMutex;
+    jack_transport_state_t state;
+    jack_position_t position;
+    bool newPosition;
+    bool syncing;
+    bool startRequested;
+    bool stopRequested;
+    bool locateRequested;
+    jack_nframes_t locateFrame;
+    // driver thread
+    pthread_t thread;
+    bool started;
+protected:
+    std::mutex portMutex;
+    std::set<MemoryPort*> ports;
+    std::atomic<bool> stopped;
+    bool runPeriod(jack_position_t &pos);
+    void skipPeriod();
+    bool transportStopped();
+    virtual void portRemoved(MemoryPort *) {}
+public:
+    OfflineDriver(jack_nframes_t sampleRate, jack_nframes_t bufferSize);
+    /**
+     * Driver thread main method.
+     */
+    virtual void run() = 0;
+    int activate(const char *clientName);
+    void shutdown();
+    jack_nframes_t getSampleRate() { return sampleRate; }
+    jack_nframes_t getBufferSize() { return bufferSize; }
+    // transport
+    bool queryTransport(jack_position_t &pos);
+    jack_nframes_t getLastFrameTime() { return frameTime.load(); }
+    void transportStart();
+    void transportStop();
+    void transportLocate(jack_nframes_t frame);
+    bool setTimebaseMaster(transport::Master *master);
+    void releaseTimebaseMaster() {
+        setTimebaseMaster(0);
+    }
+    // system ports
+    DriverPort *registerPort(const char *name, DriverPort::Type type);
+    void unregisterPort(DriverPort *port);
+    void connectPort(DriverPort *, const char *) {}
+    void disconnectPort(DriverPort *, const char *) {}
+};
+
+}
+
+#endif // OFFLINEDRIVER_H
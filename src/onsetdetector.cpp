@@ -22,7 +22,7 @@ namespace audio {
 
 OnsetDetector::OnsetDetector() :
     odf(512,1024,ComplexSpectralDifferenceHWR,HanningWindow),
-    index(0), thold(1.0), lastOnsetFrame(0), audioInput(0)
+    index(0), hopSilent(true), silentHops(0), thold(1.0), lastOnsetFrame(0), audioInput(0)
 {
     buffer = new double[ONSET_HOP_SIZE];
     for(int i = 0; i < HISTORY_SIZE; i++) {
@@ -59,16 +59,21 @@ void OnsetDetector::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t
     AudioConnection *connection = audioInput.load();
     float *audio;
     if(connection) {
-	connection->getSource()->process(rolling, pos, nframes, time);
         audio = connection->getAudio();
     } else {
         audio = AudioConnection::getDummyBuffer();
     }
+    bool silent = !connection || connection->isSilent();
+    if(!silent) {
+        hopSilent = false;
+    }
 
     // add new audio to buffer
     for(jack_nframes_t i = 0; i < nframes; i++) {
         buffer[index++] = audio[i];
         if(index == ONSET_HOP_SIZE) {
+            silentHops = hopSilent ? silentHops + 1 : 0;
+            hopSilent = silent; // rest of this period goes into the next hop
             // calculate history median
             double sorted[HISTORY_SIZE];
             for(int i = 0; i < HISTORY_SIZE; i++) {
@@ -76,8 +81,8 @@ void OnsetDetector::doProcess(bool rolling, jack_position_t &pos, jack_nframes_t
             }
             std::sort(sorted, sorted + HISTORY_SIZE);
             double median = sorted[(HISTORY_SIZE / 2) + 1];
-            // process full buffer
-            double onset = odf.calculateOnsetDetectionFunctionSample(buffer);
+            // process full buffer, the detection function is zero once it has settled on silence
+            double onset = silentHops > ONSET_SILENT_HOPS ? 0 : odf.calculateOnsetDetectionFunctionSample(buffer);
             // calculate time since last onset
             jack_nframes_t sampleRate = AudioEngine::instance().getSampleRate();
             float delta = (time - lastOnsetFrame) / (float)sampleRate;
@@ -29,12 +29,16 @@ namespace audio {
 
 const unsigned int ONSET_HOP_SIZE = 512;
 const unsigned int HISTORY_SIZE = 8;
+// two hops fill the analysis frame, two more clear the phase history
+const unsigned int ONSET_SILENT_HOPS = 4;
 
 class OnsetDetector : public Processor
 {
     OnsetDetectionFunction odf;
     unsigned int index;
     double *buffer;
+    bool hopSilent;
+    unsigned int silentHops;
     double history[HISTORY_SIZE];
     float thold;
     jack_nframes_t lastOnsetFrame;
@@ -45,10 +49,17 @@ public:
     ~OnsetDetector();
     void onOnset(ScriptFunction &handler);
     void connect(Source &source) {
-        this->audioInput.store(source.getAudioConnection(0));
+        connect(*source.getAudioConnection(0));
     }
     void connect(AudioConnection &connection) {
         this->audioInput.store(&connection);
+        AudioEngine::instance().graphChanged();
+    }
+    void getSources(std::vector<Processor*> &sources) {
+        AudioConnection *connection = audioInput.load();
+        if(connection) {
+            sources.push_back(connection->getSource());
+        }
     }
     float threshold() {
         return thold;
@@ -58,6 +69,7 @@ public:
     }
     void reset();
     void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
+    std::string getLabel() { return "Audio.OnsetDetector"; }
     void reposition() {}
 };
 
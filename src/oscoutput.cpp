@@ -18,6 +18,7 @@
 #include "oscoutput.h"
 #include "objectcollector.h"
 #include "audioengine.h"
+#include "mixer.h"
 
 #include <jack/jack.h>
 #include <chrono>
@@ -32,7 +33,7 @@ void *run_output(void *arg)
 }
 
 Output::Output(const char *host, int port) :
-    repositionNeeded(false), cancelled(false)
+    repositionNeeded(false), relocateNeeded(false), cancelled(false)
 {
     std::string portString = std::to_string(port);
     loAddress = lo_address_new(host, portString.c_str());
@@ -51,6 +52,51 @@ void Output::schedule(Message &message, int bar, int position, int division)
     eventBuffer.addEvent(new Event(pos, message));
 }
 
+/**
+ * Send the time each processor took per period since the last collection, one
+ * /bipscript/load message per processor with label, periods and min/avg/max/p95 microseconds.
+ *
+ * Runs in the script thread.
+ */
+void Output::sendLoad()
+{
+    std::vector<ProcessorLoadEntry> entries;
+    AudioEngine::instance().collectLoad(entries);
+    for(ProcessorLoadEntry &entry : entries) {
+        Message message("/bipscript/load");
+        message.addString(entry.label.c_str());
+        message.addInteger(entry.stats.periods);
+        message.addFloat(entry.stats.minimum);
+        message.addFloat(entry.stats.average);
+        message.addFloat(entry.stats.maximum);
+        message.addFloat(entry.stats.percentile95);
+        send(message);
+    }
+}
+
+/**
+ * Send the latest published levels of a mixer, one /bipscript/level message per channel with
+ * the given name, input or output, channel number and peak/rms/true peak in decibels.
+ *
+ * Runs in the script thread.
+ */
+void Output::sendLevels(audio::Mixer &mixer, const char *name)
+{
+    for(uint32_t i = 0; i < mixer.getAudioInputCount() + mixer.getAudioOutputCount(); i++) {
+        bool input = i < mixer.getAudioInputCount();
+        uint32_t channel = input ? i : i - mixer.getAudioInputCount();
+        audio::LevelReading reading = input ? mixer.getInputLevels(channel) : mixer.getOutputLevels(channel);
+        Message message("/bipscript/level");
+        message.addString(name);
+        message.addString(input ? "input" : "output");
+        message.addInteger(channel + 1);
+        message.addFloat(audio::LevelMeter::decibels(reading.peak));
+        message.addFloat(audio::LevelMeter::decibels(reading.rms));
+        message.addFloat(audio::LevelMeter::decibels(reading.truePeak));
+        send(message);
+    }
+}
+
 void Output::run()
 {
     while(!cancelled.load()) {
@@ -59,6 +105,10 @@ void Output::run()
             // eventBuffer.recycleRemaining();
             repositionNeeded.store(false);
         }
+        // events are not recycled from this thread, only the timeline cursor moves
+        if(relocateNeeded.exchange(false)) {
+            eventBuffer.seekNextPeriod();
+        }
         // get current audio position
         jack_position_t jack_pos;
         bool rolling = AudioEngine::instance().getPosition(jack_pos);
@@ -26,6 +26,11 @@
 #include <lo/lo.h>
 
 namespace bipscript {
+
+namespace audio {
+class Mixer;
+}
+
 namespace osc {
 
 class Output : public Processor
@@ -33,6 +38,7 @@ class Output : public Processor
     pthread_t thread;
     lo_address loAddress;
     std::atomic<bool> repositionNeeded;
+    std::atomic<bool> relocateNeeded;
     std::atomic<bool> cancelled;
     EventBuffer<Event> eventBuffer;
 public:
@@ -48,11 +54,15 @@ public:
         Position pos;
         eventBuffer.addEvent(new Event(pos, message));
     }
+    void sendLoad();
+    void sendLevels(audio::Mixer &mixer, const char *name);
     void run();
     void reset();
     void doProcess(bool, jack_position_t&, jack_nframes_t, jack_nframes_t) {}
+    std::string getLabel() { return "Osc.Output"; }
     void reposition() { repositionNeeded.store(true); }
     bool repositionComplete() { return !repositionNeeded.load(); }
+    void relocate() { relocateNeeded.store(true); }
     void cancel() { cancelled.store(true); }
 };
 
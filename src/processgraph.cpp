@@ -0,0 +1,631 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "processgraph.h"
+#include "audioconnection.h"
+#include "audioport.h"
+#include "midiconnection.h"
+#include "scriptgeneration.h"
+
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <sched.h>
+
+namespace bipscript {
+
+/**
+ * Take a task from the bottom of this deque.
+ *
+ * Runs in the owning thread.
+ */
+bool WorkDeque::pop(uint32_t &task)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if(t > b) {
+        // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    task = tasks[b].load(std::memory_order_relaxed);
+    if(t < b) {
+        return true;
+    }
+    // last task: race against thieves
+    bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+}
+
+/**
+ * Take a task from the top of this deque.
+ *
+ * Runs in any process worker.
+ */
+bool WorkDeque::steal(uint32_t &task)
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if(t >= b) {
+        return false;
+    }
+    task = tasks[t].load(std::memory_order_relaxed);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+ProcessGraph::ProcessGraph(uint32_t version, uint32_t nodeCount, uint16_t dequeCount)
+    : version(version), generation(ScriptGeneration::instance().getRunning()), nodeCount(nodeCount), edges(0), acyclicCount(0),
+      slots(0), assignmentCount(0), assignments(0), scratchReleased(false), aliasCount(0), aliases(0), remaining(0), dequeCount(dequeCount)
+{
+    nodes = new Node[nodeCount];
+    order = new uint32_t[nodeCount];
+    schedule = new Processor*[nodeCount];
+    pending = new std::atomic<uint32_t>[nodeCount];
+    deques = new WorkDeque[dequeCount];
+    for(uint16_t i = 0; i < dequeCount; i++) {
+        deques[i].allocate(nodeCount);
+    }
+}
+
+ProcessGraph::~ProcessGraph()
+{
+    delete[] nodes;
+    delete[] edges;
+    delete[] order;
+    delete[] schedule;
+    delete[] assignments;
+    delete[] aliases;
+    delete[] pending;
+    delete[] deques;
+}
+
+/**
+ * Derive the graph from the sources reported by each processor and sort it topologically.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates ProcessGraph.
+ */
+ProcessGraph *ProcessGraph::build(const std::set<Processor*> &processors, uint32_t version, uint16_t workers,
+                                  ProcessGraph *previous)
+{
+    ProcessGraph *graph = new ProcessGraph(version, processors.size(), workers + 1);
+
+    // index all processors
+    std::map<Processor*, uint32_t> index;
+    uint32_t counter = 0;
+    for(auto it = processors.begin(); it != processors.end(); it++) {
+        Node &node = graph->nodes[counter];
+        node.processor = *it;
+        node.dependencies = 0;
+        node.dependentCount = 0;
+        index[*it] = counter++;
+    }
+
+    // collect unique upstream edges
+    std::vector<std::vector<uint32_t>> upstream(graph->nodeCount);
+    std::vector<Processor*> sources;
+    uint32_t edgeCount = 0;
+    for(uint32_t i = 0; i < graph->nodeCount; i++) {
+        sources.clear();
+        graph->nodes[i].processor->getSources(sources);
+        std::vector<uint32_t> &inputs = upstream[i];
+        for(Processor *source : sources) {
+            auto found = index.find(source);
+            if(found != index.end() && found->second != i) {
+                inputs.push_back(found->second);
+            }
+        }
+        std::sort(inputs.begin(), inputs.end());
+        inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+        graph->nodes[i].dependencies = inputs.size();
+        for(uint32_t source : inputs) {
+            graph->nodes[source].dependentCount++;
+        }
+        edgeCount += inputs.size();
+    }
+
+    // flatten downstream edges into one array
+    graph->edges = new uint32_t[edgeCount ? edgeCount : 1];
+    uint32_t offset = 0;
+    for(uint32_t i = 0; i < graph->nodeCount; i++) {
+        Node &node = graph->nodes[i];
+        node.dependents = graph->edges + offset;
+        offset += node.dependentCount;
+        node.dependentCount = 0;
+    }
+    for(uint32_t i = 0; i < graph->nodeCount; i++) {
+        for(uint32_t source : upstream[i]) {
+            Node &node = graph->nodes[source];
+            node.dependents[node.dependentCount++] = i;
+        }
+    }
+
+    // topological order (Kahn)
+    std::vector<uint32_t> inDegree(graph->nodeCount);
+    uint32_t head = 0, tail = 0;
+    for(uint32_t i = 0; i < graph->nodeCount; i++) {
+        inDegree[i] = graph->nodes[i].dependencies;
+        if(!inDegree[i]) {
+            graph->order[tail++] = i;
+        }
+    }
+    while(head < tail) {
+        Node &node = graph->nodes[graph->order[head++]];
+        for(uint32_t d = 0; d < node.dependentCount; d++) {
+            uint32_t dependent = node.dependents[d];
+            if(!--inDegree[dependent]) {
+                graph->order[tail++] = dependent;
+            }
+        }
+    }
+    graph->acyclicCount = tail;
+    if(tail < graph->nodeCount) {
+        // nodes on a cycle run last and read the previous period of their feedback inputs
+        for(uint32_t i = 0; i < graph->nodeCount; i++) {
+            if(inDegree[i]) {
+                graph->order[tail++] = i;
+            }
+        }
+    }
+    for(uint32_t i = 0; i < graph->nodeCount; i++) {
+        graph->schedule[i] = graph->nodes[graph->order[i]].processor;
+    }
+    // outputs rendered straight into port buffers need no pool slot
+    std::set<audio::AudioConnection*> aliased;
+    graph->findAliases(aliased);
+    // buffers can only be shared when nodes never run concurrently
+    graph->assignBuffers(!graph->isParallel(), aliased);
+    // line up inputs that arrive through paths of different latency
+    graph->compensateLatency(previous);
+    return graph;
+}
+
+/**
+ * Sum the latency reported by each processor along the graph, delay the audio inputs of
+ * processors that combine faster and slower paths, and collect the latency at each system
+ * output. Delay lines of the previous graph are reused when the input and delay are the same
+ * so their contents carry over.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates DelayLine.
+ */
+void ProcessGraph::compensateLatency(ProcessGraph *previous)
+{
+    std::map<Processor*, uint32_t> index;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        index[nodes[i].processor] = i;
+    }
+    // latency at the input and output of each node, feedback inputs do not count
+    std::vector<jack_nframes_t> arrival(nodeCount, 0);
+    latencies.assign(nodeCount, 0);
+    for(uint32_t p = 0; p < nodeCount; p++) {
+        uint32_t n = order[p];
+        latencies[n] = arrival[n] + nodes[n].processor->getLatency();
+        if(p >= acyclicCount) {
+            continue;
+        }
+        for(uint32_t d = 0; d < nodes[n].dependentCount; d++) {
+            uint32_t dependent = nodes[n].dependents[d];
+            arrival[dependent] = std::max(arrival[dependent], latencies[n]);
+        }
+    }
+
+    std::vector<audio::AudioConnector*> inputs;
+    for(uint32_t p = 0; p < acyclicCount; p++) {
+        uint32_t n = order[p];
+        inputs.clear();
+        nodes[n].processor->getAudioInputs(inputs);
+        if(inputs.size() < 2) {
+            continue;
+        }
+        for(audio::AudioConnector *connector : inputs) {
+            audio::AudioConnection *connection = connector->getConnection();
+            if(!connection) {
+                continue;
+            }
+            auto source = index.find(connection->getSource());
+            if(source == index.end() || latencies[source->second] >= arrival[n]) {
+                continue;
+            }
+            jack_nframes_t delay = arrival[n] - latencies[source->second];
+            InputDelay input = { connector, connection, 0 };
+            // keep the old line and its audio unless the delay or buffer size changed
+            if(previous) {
+                for(InputDelay &old : previous->delays) {
+                    if(old.connector == connector && old.connection == connection
+                            && old.line->getDelay() == delay
+                            && old.line->getMaxFrames() >= audio::AudioConnection::getBufferSize()) {
+                        input.line = old.line;
+                        break;
+                    }
+                }
+            }
+            if(!input.line) {
+                input.line.reset(new audio::DelayLine(delay, audio::AudioConnection::getBufferSize()));
+            }
+            delays.push_back(input);
+        }
+    }
+
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        audio::AudioOutputPort *port = dynamic_cast<audio::AudioOutputPort*>(nodes[i].processor);
+        if(port) {
+            PortLatency latency = { port->getDriverPort(), arrival[i] };
+            portLatencies.push_back(latency);
+        }
+    }
+}
+
+/**
+ * Find pooled audio outputs that are read by a single system output port and nothing else,
+ * their producer can render into the port buffer and the port skips its copy.
+ *
+ * Only producers whose dependents are all output ports qualify, other readers do not report
+ * which of the outputs they read.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates PortAlias.
+ */
+void ProcessGraph::findAliases(std::set<audio::AudioConnection*> &aliased)
+{
+    std::vector<PortAlias> list;
+    std::map<audio::AudioConnection*, uint32_t> readers;
+    std::map<audio::AudioConnection*, DriverPort*> ports;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        Node &node = nodes[i];
+        audio::Source *source = dynamic_cast<audio::Source*>(node.processor);
+        if(!source || !node.dependentCount) {
+            continue;
+        }
+        readers.clear();
+        ports.clear();
+        bool portsOnly = true;
+        for(uint32_t d = 0; d < node.dependentCount; d++) {
+            audio::AudioOutputPort *port = dynamic_cast<audio::AudioOutputPort*>(nodes[node.dependents[d]].processor);
+            if(!port) {
+                portsOnly = false;
+                break;
+            }
+            audio::AudioConnection *connection = port->getConnection();
+            if(connection) {
+                readers[connection]++;
+                ports[connection] = port->getDriverPort();
+            }
+        }
+        if(!portsOnly) {
+            continue;
+        }
+        for(auto &entry : readers) {
+            audio::AudioConnection *connection = entry.first;
+            if(entry.second == 1 && connection->isPooled() && connection->getSource() == source) {
+                list.push_back({connection, ports[connection]});
+                aliased.insert(connection);
+            }
+        }
+    }
+    aliasCount = list.size();
+    aliases = new PortAlias[aliasCount ? aliasCount : 1];
+    std::copy(list.begin(), list.end(), aliases);
+}
+
+/**
+ * Give every pooled audio output a BufferPool slot. When shared, an output takes over the slot
+ * of an output whose last reader has already run, like registers in a compiler.
+ *
+ * Runs in the script thread.
+ *
+ * Allocates BufferAssignment.
+ */
+void ProcessGraph::assignBuffers(bool shared, const std::set<audio::AudioConnection*> &aliased)
+{
+    std::vector<uint32_t> position(nodeCount);
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        position[order[i]] = i;
+    }
+    std::vector<BufferAssignment> list;
+    std::vector<uint32_t> freeSlots;
+    std::multimap<uint32_t, uint32_t> expiry; // last reader position -> slot
+    uint32_t slotCount = 0;
+    for(uint32_t p = 0; p < nodeCount; p++) {
+        // release slots not read by this node or later, inputs stay live while outputs are chosen
+        while(!expiry.empty() && expiry.begin()->first < p) {
+            freeSlots.push_back(expiry.begin()->second);
+            expiry.erase(expiry.begin());
+        }
+        Node &node = nodes[order[p]];
+        audio::Source *source = dynamic_cast<audio::Source*>(node.processor);
+        if(!source) {
+            continue;
+        }
+        // outputs on a cycle are read again next period
+        uint32_t lastRead = p < acyclicCount ? p : UINT_MAX;
+        for(uint32_t d = 0; d < node.dependentCount && lastRead != UINT_MAX; d++) {
+            lastRead = std::max(lastRead, position[node.dependents[d]]);
+        }
+        for(uint32_t i = 0; i < source->getAudioOutputCount(); i++) {
+            audio::AudioConnection *connection = source->getAudioConnection(i);
+            if(!connection->isPooled() || connection->getSource() != source || aliased.count(connection)) {
+                continue;
+            }
+            uint32_t slot;
+            if(shared && !freeSlots.empty()) {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            } else {
+                slot = slotCount++;
+            }
+            list.push_back({connection, slot});
+            if(shared && lastRead != UINT_MAX) {
+                expiry.insert(std::make_pair(lastRead, slot));
+            }
+        }
+    }
+    assignmentCount = list.size();
+    assignments = new BufferAssignment[assignmentCount ? assignmentCount : 1];
+    std::copy(list.begin(), list.end(), assignments);
+    blocks = audio::BufferPool::instance().reserve(slotCount);
+    slots = blocks ? blocks->table : 0;
+    audio::BufferPool::instance().setUsage(assignmentCount, slotCount);
+}
+
+static std::string escapeLabel(const std::string &label)
+{
+    std::string escaped;
+    for(char c : label) {
+        if(c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+/**
+ * Write the graph as DOT or JSON with the outputs, buffers and recent cost of each node, and
+ * mark the most expensive path through the graph.
+ *
+ * Runs in the script thread.
+ */
+void ProcessGraph::describe(std::ostream &out, bool json)
+{
+    // buffer of each pooled or aliased output
+    std::map<audio::AudioConnection*, std::string> buffers;
+    for(uint32_t i = 0; i < assignmentCount; i++) {
+        buffers[assignments[i].connection] = "slot " + std::to_string(assignments[i].slot);
+    }
+    for(uint32_t i = 0; i < aliasCount; i++) {
+        buffers[aliases[i].connection] = "port";
+    }
+    // most expensive path in topological order
+    std::vector<double> cost(nodeCount), pathCost(nodeCount, 0);
+    std::vector<int64_t> previous(nodeCount, -1);
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        cost[i] = nodes[i].processor->getRecentLoad();
+    }
+    int64_t last = -1;
+    for(uint32_t p = 0; p < acyclicCount; p++) {
+        uint32_t n = order[p];
+        pathCost[n] += cost[n];
+        if(last < 0 || pathCost[n] > pathCost[last]) {
+            last = n;
+        }
+        for(uint32_t d = 0; d < nodes[n].dependentCount; d++) {
+            uint32_t dependent = nodes[n].dependents[d];
+            if(pathCost[n] > pathCost[dependent]) {
+                pathCost[dependent] = pathCost[n];
+                previous[dependent] = n;
+            }
+        }
+    }
+    std::vector<bool> critical(nodeCount, false);
+    double criticalCost = last < 0 ? 0 : pathCost[last];
+    for(int64_t n = last; n >= 0; n = previous[n]) {
+        critical[n] = true;
+    }
+
+    out << (json ? "{\"version\": " : "digraph bipscript {\n  // version ") << version
+        << (json ? ", \"parallel\": " : ", parallel ") << (isParallel() ? "true" : "false")
+        << (json ? ", \"criticalPath\": " : ", critical path ") << criticalCost
+        << (json ? ",\n  \"nodes\": [\n" : " us\n  rankdir=LR;\n  node [shape=box];\n");
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        Node &node = nodes[i];
+        std::string label = escapeLabel(node.processor->getLabel());
+        std::string type = label.substr(0, label.find(' '));
+        audio::Source *audioSource = dynamic_cast<audio::Source*>(node.processor);
+        midi::Source *midiSource = dynamic_cast<midi::Source*>(node.processor);
+        uint32_t audioOutputs = audioSource ? audioSource->getAudioOutputCount() : 0;
+        uint32_t midiOutputs = midiSource ? midiSource->getMidiOutputCount() : 0;
+        std::vector<std::string> outputBuffers;
+        for(uint32_t o = 0; o < audioOutputs; o++) {
+            auto found = buffers.find(audioSource->getAudioConnection(o));
+            outputBuffers.push_back(found != buffers.end() ? found->second : "own");
+        }
+        if(json) {
+            out << "    {\"id\": " << i << ", \"type\": \"" << type << "\", \"label\": \"" << label
+                << "\", \"inputs\": " << node.dependencies << ", \"audioOutputs\": " << audioOutputs
+                << ", \"midiOutputs\": " << midiOutputs << ", \"buffers\": [";
+            for(uint32_t o = 0; o < outputBuffers.size(); o++) {
+                out << (o ? ", \"" : "\"") << outputBuffers[o] << "\"";
+            }
+            out << "], \"latency\": " << latencies[i] << ", \"cost\": " << cost[i] << ", \"critical\": " << (critical[i] ? "true" : "false")
+                << (i + 1 < nodeCount ? "},\n" : "}\n");
+        } else {
+            out << "  n" << i << " [label=\"" << label << "\\ninputs " << node.dependencies
+                << ", audio out " << audioOutputs << ", midi out " << midiOutputs;
+            for(uint32_t o = 0; o < outputBuffers.size(); o++) {
+                out << (o ? ", " : "\\nbuffers ") << outputBuffers[o];
+            }
+            out << "\\nlatency " << latencies[i] << ", " << cost[i] << " us\"" << (critical[i] ? ", color=red" : "") << "];\n";
+        }
+    }
+    out << (json ? "  ],\n  \"edges\": [" : "");
+    bool first = true;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        for(uint32_t d = 0; d < nodes[i].dependentCount; d++) {
+            uint32_t dependent = nodes[i].dependents[d];
+            if(json) {
+                out << (first ? "[" : ", [") << i << ", " << dependent << "]";
+            } else {
+                out << "  n" << i << " -> n" << dependent
+                    << (critical[i] && critical[dependent] && previous[dependent] == i ? " [color=red];\n" : ";\n");
+            }
+            first = false;
+        }
+    }
+    out << (json ? "]\n}\n" : "}\n");
+}
+
+/**
+ * Point the pooled audio connections at the slots assigned in this graph.
+ *
+ * Runs in the process thread.
+ */
+void ProcessGraph::applyBuffers()
+{
+    for(uint32_t i = 0; i < assignmentCount; i++) {
+        assignments[i].connection->setBuffer(slots[assignments[i].slot]);
+    }
+}
+
+/**
+ * Largest block the slots of this graph hold, smaller than the period until a graph built
+ * after a buffer size increase is installed.
+ *
+ * Runs in the process thread.
+ */
+jack_nframes_t ProcessGraph::getMaxFrames()
+{
+    return blocks ? blocks->frames : 0;
+}
+
+/**
+ * Free the buffers the pooled connections of this graph used before they had a slot.
+ *
+ * Runs in the script thread once the process thread has installed this graph.
+ */
+void ProcessGraph::releaseScratch()
+{
+    if(scratchReleased) {
+        return;
+    }
+    for(uint32_t i = 0; i < assignmentCount; i++) {
+        assignments[i].connection->releaseScratch();
+    }
+    scratchReleased = true;
+}
+
+/**
+ * Point the aliased audio connections at the port buffers of this period, from the given offset.
+ *
+ * Runs in the process thread before the graph is run.
+ */
+void ProcessGraph::applyAliases(jack_nframes_t periodFrames, jack_nframes_t offset)
+{
+    for(uint32_t i = 0; i < aliasCount; i++) {
+        aliases[i].connection->setBuffer((float*)aliases[i].port->getBuffer(periodFrames) + offset);
+    }
+}
+
+/**
+ * Attach the delay lines of this graph to their inputs.
+ *
+ * Runs in the process thread when the graph is installed.
+ */
+void ProcessGraph::applyDelays()
+{
+    for(InputDelay &input : delays) {
+        // an input reconnected since the build stays undelayed until the next graph
+        if(input.connector->getConnection() == input.connection) {
+            input.connector->setDelayLine(input.line.get());
+        }
+    }
+}
+
+/**
+ * Detach the delay lines of this graph before another graph is installed.
+ *
+ * Runs in the process thread.
+ */
+void ProcessGraph::clearDelays()
+{
+    for(InputDelay &input : delays) {
+        input.connector->setDelayLine(0);
+    }
+}
+
+/**
+ * Reset the dependency counters and seed the root nodes for a new period.
+ *
+ * Runs in the process thread before the workers are started.
+ */
+void ProcessGraph::prepare()
+{
+    for(uint16_t i = 0; i < dequeCount; i++) {
+        deques[i].reset();
+    }
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        pending[i].store(nodes[i].dependencies, std::memory_order_relaxed);
+    }
+    // roots come first in topological order
+    for(uint32_t i = 0; i < nodeCount && !nodes[order[i]].dependencies; i++) {
+        deques[0].push(order[i]);
+    }
+    remaining.store(nodeCount, std::memory_order_release);
+}
+
+/**
+ * Run nodes as their dependencies complete until the whole graph has been processed.
+ *
+ * Runs in the process thread (worker zero) and in each process worker.
+ */
+void ProcessGraph::execute(uint16_t worker, bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time)
+{
+    WorkDeque &own = deques[worker];
+    uint16_t victim = worker;
+    while(remaining.load(std::memory_order_acquire)) {
+        uint32_t task;
+        if(!own.pop(task)) {
+            // steal round robin from the other workers
+            victim = (victim + 1) % dequeCount;
+            if(victim == worker || !deques[victim].steal(task)) {
+                if(victim == worker) {
+                    sched_yield(); // nothing found in a full round
+                }
+                continue;
+            }
+        }
+        Node &node = nodes[task];
+        node.processor->process(rolling, pos, nframes, time);
+        // release dependents whose inputs are now complete
+        for(uint32_t d = 0; d < node.dependentCount; d++) {
+            uint32_t dependent = node.dependents[d];
+            if(pending[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                own.push(dependent);
+            }
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+}
@@ -0,0 +1,159 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROCESSGRAPH_H
+#define PROCESSGRAPH_H
+
+#include "processor.h"
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <set>
+
+namespace bipscript {
+
+class DriverPort;
+
+namespace audio {
+class AudioConnection;
+class AudioConnector;
+class BufferBlocks;
+class DelayLine;
+}
+
+/**
+ * Bounded work-stealing deque of node indices (Chase-Lev).
+ *
+ * Only the owning thread may push and pop, any thread may steal.
+ */
+class WorkDeque
+{
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<uint32_t> *tasks;
+public:
+    WorkDeque() : top(0), bottom(0), tasks(0) {}
+    ~WorkDeque() { delete[] tasks; }
+    void allocate(uint32_t capacity) {
+        tasks = new std::atomic<uint32_t>[capacity ? capacity : 1];
+    }
+    void reset() {
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+    void push(uint32_t task) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        tasks[b].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    bool pop(uint32_t &task);
+    bool steal(uint32_t &task);
+};
+
+/**
+ * Immutable snapshot of the processor graph derived from the audio and MIDI connections,
+ * with the processors flattened into a topologically sorted schedule.
+ *
+ * Built in the script thread, executed in the process thread and the process workers.
+ */
+class ProcessGraph
+{
+    struct Node {
+        Processor *processor;
+        uint32_t dependencies;
+        uint32_t dependentCount;
+        uint32_t *dependents;
+    };
+    struct BufferAssignment {
+        audio::AudioConnection *connection;
+        uint32_t slot;
+    };
+    struct PortAlias {
+        audio::AudioConnection *connection;
+        DriverPort *port;
+    };
+    struct InputDelay {
+        audio::AudioConnector *connector;
+        audio::AudioConnection *connection;
+        std::shared_ptr<audio::DelayLine> line;
+    };
+    struct PortLatency {
+        DriverPort *port;
+        jack_nframes_t latency;
+    };
+    const uint32_t version;
+    uint32_t generation; // script run this graph belongs to
+    uint32_t nodeCount;
+    Node *nodes;
+    uint32_t *edges;
+    uint32_t *order;
+    Processor **schedule;
+    uint32_t acyclicCount; // nodes ahead of any cycle in the schedule
+    std::shared_ptr<audio::BufferBlocks> blocks;
+    float **slots;
+    uint32_t assignmentCount;
+    BufferAssignment *assignments;
+    bool scratchReleased;
+    uint32_t aliasCount;
+    PortAlias *aliases;
+    std::vector<jack_nframes_t> latencies; // at the output of each node
+    std::vector<InputDelay> delays;
+    std::vector<PortLatency> portLatencies;
+    // per period execution state
+    std::atomic<uint32_t> *pending;
+    std::atomic<uint32_t> remaining;
+    uint16_t dequeCount;
+    WorkDeque *deques;
+    ProcessGraph(uint32_t version, uint32_t nodeCount, uint16_t dequeCount);
+    void findAliases(std::set<audio::AudioConnection*> &aliased);
+    void assignBuffers(bool shared, const std::set<audio::AudioConnection*> &aliased);
+    void compensateLatency(ProcessGraph *previous);
+public:
+    static ProcessGraph *build(const std::set<Processor*> &processors, uint32_t version, uint16_t workers,
+                               ProcessGraph *previous);
+    ~ProcessGraph();
+    uint32_t getVersion() { return version; }
+    uint32_t getGeneration() { return generation; }
+    uint32_t size() { return nodeCount; }
+    jack_nframes_t getMaxFrames();
+    Processor *getProcessor(uint32_t index) { return schedule[index]; }
+    bool isParallel() { return acyclicCount == nodeCount && dequeCount > 1; }
+    void describe(std::ostream &out, bool json);
+    void applyBuffers();
+    void releaseScratch();
+    void applyAliases(jack_nframes_t periodFrames, jack_nframes_t offset);
+    void applyDelays();
+    void clearDelays();
+    const std::vector<PortLatency> &getPortLatencies() { return portLatencies; }
+    void run(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time) {
+        for(uint32_t i = 0; i < nodeCount; i++) {
+            schedule[i]->process(rolling, pos, nframes, time);
+        }
+    }
+    void endPeriod() {
+        for(uint32_t i = 0; i < nodeCount; i++) {
+            schedule[i]->endPeriod();
+        }
+    }
+    void prepare();
+    void execute(uint16_t worker, bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
+};
+
+}
+
+#endif // PROCESSGRAPH_H
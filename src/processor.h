@@ -18,27 +18,78 @@
 #define PROCESSOR_H
 
 #include "listable.h"
+#include "processorload.h"
 
 #include <jack/types.h>
+#include <string>
+#include <vector>
 
 namespace bipscript {
 
+namespace audio {
+class AudioConnector;
+}
+
 class Processor : public Listable
 {
-    jack_nframes_t processedUntil;
+    ProcessorLoad load;
 public:
-    Processor() : processedUntil(0) {}
     /**
+     * Called once per block in schedule order, after all sources of this object have run.
+     * Sources are no longer pulled from here so the recorded time is this object's alone.
      *
-     * Runs in the process thread.
+     * Runs in the process thread or a process worker thread.
      */
     void process(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time) {
-        if(processedUntil >= time) {
-            return;
-        }
+        uint64_t start = ProcessorLoad::now();
         doProcess(rolling, pos, nframes, time);
-        processedUntil = time;
+        load.add(ProcessorLoad::now() - start);
+    }
+    /**
+     * Records the time of all blocks of the period that just ran.
+     *
+     * Runs in the process thread.
+     */
+    void endPeriod() {
+        load.endPeriod();
     }
+    /**
+     * Reads the processing time since the last call.
+     *
+     * Runs in the script thread.
+     */
+    void collectLoad(LoadStats &stats) {
+        load.collect(stats);
+    }
+    double getRecentLoad() {
+        return load.getRecent();
+    }
+    /**
+     * Short description of this object for load and graph reports.
+     *
+     * Runs in the script thread.
+     */
+    virtual std::string getLabel() { return "Processor"; }
+    /**
+     * Adds the processors this object reads from in doProcess to the given list so they
+     * can be scheduled ahead of it.
+     *
+     * Runs in the script thread.
+     */
+    virtual void getSources(std::vector<Processor*> &) {}
+    /**
+     * Adds the audio inputs this object sums or processes together so the graph can delay
+     * the ones reached through faster paths.
+     *
+     * Runs in the script thread.
+     */
+    virtual void getAudioInputs(std::vector<audio::AudioConnector*> &) {}
+    /**
+     * Frames this object delays the audio passing through it.
+     *
+     * Runs in the script thread.
+     */
+    virtual jack_nframes_t getLatency() { return 0; }
     /**
      * Called when a reposition has been requested so objects can flush/recycle queued events.
      *
@@ -53,6 +104,13 @@ public:
      * Runs in the process thread.
      */
     virtual bool repositionComplete() { return true; }
+    /**
+     * Called when the transport moves while event timelines are enabled, objects move their
+     * timeline cursors and drop events not on a timeline.
+     *
+     * Runs in the process thread.
+     */
+    virtual void relocate() {}
 protected:
     virtual void doProcess(bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time) = 0;
 };
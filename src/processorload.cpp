@@ -0,0 +1,61 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "processorload.h"
+
+namespace bipscript {
+
+/**
+ * Read the figures accumulated since the last collection and start a new interval.
+ *
+ * Runs in the script thread.
+ */
+void ProcessorLoad::collect(LoadStats &stats)
+{
+    uint64_t count = periods.exchange(0);
+    uint64_t sum = total.exchange(0);
+    uint32_t low = minimum.exchange(UINT32_MAX);
+    uint32_t high = maximum.exchange(0);
+    uint32_t counts[LogHistogram::BUCKETS];
+    uint64_t counted = 0;
+    for(uint32_t i = 0; i < LogHistogram::BUCKETS; i++) {
+        counts[i] = histogram.take(i);
+        counted += counts[i];
+    }
+    stats.periods = count;
+    if(!count) {
+        stats.minimum = stats.average = stats.maximum = stats.percentile95 = 0;
+        return;
+    }
+    stats.minimum = low == UINT32_MAX ? 0 : low / 1000.0;
+    stats.average = sum / 1000.0 / count;
+    stats.maximum = high / 1000.0;
+    // upper limit of the bucket holding the 95th percentile, within the observed range
+    uint64_t target = (counted * 95 + 99) / 100;
+    uint64_t seen = 0;
+    stats.percentile95 = stats.maximum;
+    for(uint32_t i = 0; i < LogHistogram::BUCKETS; i++) {
+        seen += counts[i];
+        if(seen && seen >= target) {
+            double limit = LogHistogram::bucketLimit(i) / 1000.0;
+            stats.percentile95 = limit < stats.maximum ? limit : stats.maximum;
+            break;
+        }
+    }
+}
+
+}
@@ -0,0 +1,154 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROCESSORLOAD_H
+#define PROCESSORLOAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <time.h>
+
+namespace bipscript {
+
+/**
+ * Load figures of one processor in microseconds per period.
+ */
+struct LoadStats
+{
+    uint64_t periods;
+    double minimum;
+    double average;
+    double maximum;
+    double percentile95;
+};
+
+/**
+ * Lock free histogram with two buckets per power of two, for one writer thread and readers
+ * in any thread.
+ */
+class LogHistogram
+{
+public:
+    static const uint32_t BUCKETS = 64;
+    LogHistogram() {
+        for(uint32_t i = 0; i < BUCKETS; i++) {
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    static uint32_t bucket(uint32_t value) {
+        if(value < 2) {
+            return 0;
+        }
+        uint32_t octave = 31 - __builtin_clz(value);
+        return 2 * octave + ((value >> (octave - 1)) & 1);
+    }
+    /**
+     * Smallest value above the given bucket.
+     */
+    static double bucketLimit(uint32_t bucket) {
+        uint32_t octave = bucket / 2;
+        return (double)(1ull << octave) * (bucket % 2 ? 2.0 : 1.5);
+    }
+    void add(uint32_t value) {
+        counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+    uint32_t get(uint32_t bucket) {
+        return counts[bucket].load(std::memory_order_relaxed);
+    }
+    uint32_t take(uint32_t bucket) {
+        return counts[bucket].exchange(0);
+    }
+private:
+    std::atomic<uint32_t> counts[BUCKETS];
+};
+
+/**
+ * Execution time of a processor, accumulated lock free by the thread running it and
+ * collected by the script thread.
+ *
+ * Times go into a histogram of nanoseconds so percentiles can be estimated without storing
+ * samples.
+ */
+class ProcessorLoad
+{
+    std::atomic<uint64_t> periods;
+    std::atomic<uint64_t> total;
+    std::atomic<uint32_t> minimum;
+    std::atomic<uint32_t> maximum;
+    std::atomic<uint32_t> recent; // moving average over about 16 periods
+    LogHistogram histogram;
+    uint64_t blocks; // time of the blocks run so far this period
+    bool ran;
+public:
+    ProcessorLoad() : periods(0), total(0), minimum(UINT32_MAX), maximum(0), recent(0), blocks(0), ran(false) {}
+    static uint64_t now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+    /**
+     * Add the time of one block, blocks of a period may run in different workers one after
+     * another.
+     *
+     * Runs in the process thread or a process worker thread.
+     */
+    void add(uint64_t elapsed) {
+        blocks += elapsed;
+        ran = true;
+    }
+    /**
+     * Record the blocks added since the last call as one period.
+     *
+     * Runs in the process thread.
+     */
+    void endPeriod() {
+        if(ran) {
+            record(blocks);
+            blocks = 0;
+            ran = false;
+        }
+    }
+    /**
+     * Add the time of one period.
+     *
+     * Runs in the process thread or a process worker thread.
+     */
+    void record(uint64_t elapsed) {
+        uint32_t ns = elapsed > UINT32_MAX ? UINT32_MAX : elapsed;
+        periods.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(ns, std::memory_order_relaxed);
+        if(ns < minimum.load(std::memory_order_relaxed)) {
+            minimum.store(ns, std::memory_order_relaxed);
+        }
+        if(ns > maximum.load(std::memory_order_relaxed)) {
+            maximum.store(ns, std::memory_order_relaxed);
+        }
+        histogram.add(ns);
+        uint32_t average = recent.load(std::memory_order_relaxed);
+        recent.store(average - average / 16 + ns / 16, std::memory_order_relaxed);
+    }
+    void collect(LoadStats &stats);
+    /**
+     * Recent average in microseconds, unlike collect this does not start a new interval.
+     */
+    double getRecent() {
+        return recent.load(std::memory_order_relaxed) / 1000.0;
+    }
+};
+
+}
+
+#endif // PROCESSORLOAD_H
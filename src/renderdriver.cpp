@@ -0,0 +1,205 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "renderdriver.h"
+#include "scripthost.h"
+#include "position.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unistd.h>
+
+namespace bipscript {
+
+std::string RenderDriver::filePath(MemoryPort *port, const char *extension)
+{
+    std::string name(port->getName());
+    for(char &c : name) {
+        if(c == '/') {
+            c = '_';
+        }
+    }
+    return folder + "/" + name + extension;
+}
+
+/**
+ * Append the given frames of the current period of every system output port to its file,
+ * ports registered after the start of the render are padded with silence.
+ *
+ * Runs in the driver thread.
+ */
+void RenderDriver::writePeriod(jack_position_t &pos, jack_nframes_t offset, jack_nframes_t frames)
+{
+    std::lock_guard<std::mutex> lock(portMutex);
+    for(MemoryPort *port : ports) {
+        if(port->getType() == DriverPort::AUDIO_OUTPUT) {
+            audio::WavWriter *&writer = wavWriters[port];
+            if(!writer) {
+                writer = new audio::WavWriter(filePath(port, ".wav"), getSampleRate());
+                writer->writeSilence(renderedFrames);
+            }
+            writer->write(port->getAudio() + offset, frames);
+        }
+        else if(port->getType() == DriverPort::MIDI_OUTPUT) {
+            midi::MidiFileWriter *&writer = midiWriters[port];
+            if(!writer) {
+                writer = new midi::MidiFileWriter(filePath(port, ".mid"), getSampleRate());
+                writer->setTimeSignature(pos.beats_per_bar, pos.beat_type);
+                writer->setTempo(pos.beats_per_minute, pos.beat_type);
+                writer->advance(renderedFrames);
+            }
+            writer->setTempo(pos.beats_per_minute, pos.beat_type);
+            uint32_t count = port->getMidiEventCount(0);
+            for(uint32_t i = 0; i < count; i++) {
+                jack_midi_event_t event;
+                port->getMidiEvent(0, i, event);
+                if(event.time >= offset && event.time < offset + frames) {
+                    writer->addEvent(event.time - offset, event.buffer, event.size);
+                }
+            }
+            writer->advance(frames);
+        }
+    }
+    renderedFrames += frames;
+}
+
+void RenderDriver::closeWriters()
+{
+    std::lock_guard<std::mutex> lock(portMutex);
+    for(auto &entry : wavWriters) {
+        delete entry.second;
+    }
+    wavWriters.clear();
+    for(auto &entry : midiWriters) {
+        entry.second->close();
+        delete entry.second;
+    }
+    midiWriters.clear();
+}
+
+/**
+ * Finish the file of a port removed during the render.
+ *
+ * Called with the port mutex held.
+ */
+void RenderDriver::portRemoved(MemoryPort *port)
+{
+    auto wav = wavWriters.find(port);
+    if(wav != wavWriters.end()) {
+        delete wav->second;
+        wavWriters.erase(wav);
+    }
+    auto midi = midiWriters.find(port);
+    if(midi != midiWriters.end()) {
+        midi->second->close();
+        delete midi->second;
+        midiWriters.erase(midi);
+    }
+}
+
+/**
+ * Run stopped periods until the script has been evaluated, then roll the transport from the
+ * start and run periods back to back until the end of the last bar.
+ *
+ * Bars before the render range are processed but not written so that tails and held notes
+ * carry into the range, the files start on the downbeat of the first bar and end on the
+ * downbeat after the last. A transport stopped by the script ends the render early, one that
+ * does not start within MAX_SYNC_PERIODS periods aborts it.
+ */
+void RenderDriver::run()
+{
+    jack_position_t pos;
+    while(!stopped.load() && ScriptHost::instance().running()) {
+        runPeriod(pos);
+        usleep(1000);
+    }
+    transportLocate(0);
+    transportStart();
+
+    std::chrono::steady_clock::time_point start;
+    uint64_t processedFrames = 0;
+    uint32_t syncPeriods = 0;
+    bool finished = false;
+    bool failed = false;
+    bool stoppedEarly = false;
+    while(!stopped.load()) {
+        bool rolling = runPeriod(pos);
+        if(!rolling) {
+            if(transportStopped()) {
+                finished = stoppedEarly = processedFrames > 0;
+                failed = !finished;
+                break;
+            }
+            // still syncing, give the script thread time to reposition
+            if(++syncPeriods > MAX_SYNC_PERIODS) {
+                failed = true;
+                break;
+            }
+            usleep(1000);
+            continue;
+        }
+        syncPeriods = 0;
+        if(!processedFrames) {
+            start = std::chrono::steady_clock::now();
+        }
+        jack_nframes_t bufferSize = getBufferSize();
+        processedFrames += bufferSize;
+        long begin = 0;
+        long end = bufferSize;
+        if(pos.valid & JackPositionBBT) {
+            // frame offsets of the range bar lines within this period
+            begin = std::max(begin, Position(fromBar, 0, 1).calculateFrameOffset(pos));
+            end = std::min(end, Position(toBar + 1, 0, 1).calculateFrameOffset(pos));
+            if(end <= 0) {
+                finished = true;
+                break;
+            }
+            if(begin >= end) {
+                continue;
+            }
+        }
+        writePeriod(pos, begin, end - begin);
+        if(end < (long)bufferSize) {
+            finished = true;
+            break;
+        }
+    }
+    closeWriters();
+    if(finished) {
+        // bars before the range cost processing time too
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double audioSeconds = (double)renderedFrames / getSampleRate();
+        double processedSeconds = (double)processedFrames / getSampleRate();
+        std::cerr << "rendered bars " << fromBar << " to " << toBar << " to " << folder
+                  << ": " << audioSeconds << "s of audio, " << processedSeconds << "s processed in "
+                  << elapsed.count() << "s (" << processedSeconds / elapsed.count() << "x realtime)";
+        if(stoppedEarly) {
+            std::cerr << ", the transport stopped in bar " << pos.bar;
+        }
+        std::cerr << std::endl;
+    }
+    if(failed) {
+        std::cerr << "render to " << folder << " failed: the transport "
+                  << (syncPeriods > MAX_SYNC_PERIODS ? "did not start" : "was stopped before it rolled") << std::endl;
+    }
+    if(finished || failed) {
+        ScriptHost::instance().stop();
+    }
+}
+
+}
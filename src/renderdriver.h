@@ -0,0 +1,58 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RENDERDRIVER_H
+#define RENDERDRIVER_H
+
+#include "offlinedriver.h"
+#include "wavwriter.h"
+#include "midifilewriter.h"
+
+#include <map>
+
+namespace bipscript {
+
+/**
+ * Renders a range of bars faster than realtime, writing each system output port to a file.
+ *
+ * Audio outputs are written as <port name>.wav and MIDI outputs as <port name>.mid in the
+ * render folder.
+ */
+class RenderDriver : public OfflineDriver
+{
+    static const uint32_t MAX_SYNC_PERIODS = 10000; // about ten seconds
+    std::string folder;
+    uint32_t fromBar;
+    uint32_t toBar;
+    std::map<MemoryPort*, audio::WavWriter*> wavWriters;
+    std::map<MemoryPort*, midi::MidiFileWriter*> midiWriters;
+    jack_nframes_t renderedFrames;
+    std::string filePath(MemoryPort *port, const char *extension);
+    void writePeriod(jack_position_t &pos, jack_nframes_t offset, jack_nframes_t frames);
+    void closeWriters();
+protected:
+    void portRemoved(MemoryPort *port);
+public:
+    RenderDriver(const std::string &folder, uint32_t fromBar, uint32_t toBar,
+                 jack_nframes_t sampleRate, jack_nframes_t bufferSize)
+        : OfflineDriver(sampleRate, bufferSize), folder(folder),
+          fromBar(fromBar), toBar(toBar), renderedFrames(0) {}
+    void run();
+};
+
+}
+
+#endif // RENDERDRIVER_H
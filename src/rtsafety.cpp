@@ -0,0 +1,198 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "rtsafety.h"
+#include "memorypool.h"
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <iostream>
+
+namespace bipscript {
+
+static std::atomic<bool> detecting(false);
+static __thread int processDepth = 0;
+static __thread bool recording = false;
+
+static const char *violationNames[] = {"malloc", "calloc", "realloc", "free", "pthread_mutex_lock"};
+
+RtSafety::RtSafety() : enabled(false), tracing(false), traceCount(0)
+{
+    for(int i = 0; i < VIOLATION_TYPES; i++) {
+        counts[i].store(0);
+    }
+}
+
+/**
+ * Start counting calls made in process periods, with backtraces if tracing.
+ *
+ * Runs in the main thread before the audio engine is activated.
+ */
+void RtSafety::enable(bool tracing)
+{
+    this->tracing = tracing;
+    if(tracing) {
+        // the first backtrace loads the unwinder, not something to do in a process period
+        void *frames[1];
+        backtrace(frames, 1);
+    }
+    enabled.store(true);
+    detecting.store(true);
+}
+
+/**
+ * Fault in the process memory pool and lock all current and future pages of the process
+ * so page faults do not happen in the process callback.
+ *
+ * Runs in the main thread before the audio engine is activated.
+ */
+void RtSafety::lockMemory()
+{
+    MemoryPool::processPool();
+    if(mlockall(MCL_CURRENT | MCL_FUTURE)) {
+        std::cerr << "warning: could not lock memory, check the memlock limit" << std::endl;
+    }
+}
+
+void RtSafety::enterProcess()
+{
+    processDepth++;
+}
+
+void RtSafety::leaveProcess()
+{
+    processDepth--;
+}
+
+/**
+ * Called by the interposed functions in every thread, only records calls from a process period.
+ */
+void RtSafety::check(Violation violation)
+{
+    if(!processDepth || recording || !detecting.load(std::memory_order_relaxed)) {
+        return;
+    }
+    recording = true;
+    instance().record(violation);
+    recording = false;
+}
+
+/**
+ * Runs in the process thread or a process worker.
+ */
+void RtSafety::record(Violation violation)
+{
+    counts[violation].fetch_add(1, std::memory_order_relaxed);
+    if(tracing) {
+        uint32_t index = traceCount.fetch_add(1, std::memory_order_relaxed);
+        if(index < TRACE_LOG) {
+            Trace &trace = traces[index];
+            trace.violation = violation;
+            trace.depth = backtrace(trace.frames, TRACE_DEPTH);
+        }
+    }
+}
+
+uint64_t RtSafety::getTotal()
+{
+    uint64_t total = 0;
+    for(int i = 0; i < VIOLATION_TYPES; i++) {
+        total += counts[i].load();
+    }
+    return total;
+}
+
+/**
+ * Write the counts and the kept backtraces, the backtraces go straight to stderr.
+ *
+ * Runs in the main or script thread.
+ */
+void RtSafety::dump(std::ostream &out)
+{
+    if(!enabled.load()) {
+        return;
+    }
+    out << "rt safety: " << getTotal() << " unsafe calls in the process thread";
+    for(int i = 0; i < VIOLATION_TYPES; i++) {
+        uint64_t count = counts[i].load();
+        if(count) {
+            out << ", " << violationNames[i] << " " << count;
+        }
+    }
+    out << std::endl;
+    uint32_t traced = traceCount.load();
+    traced = traced < TRACE_LOG ? traced : TRACE_LOG;
+    for(uint32_t i = 0; i < traced; i++) {
+        out << "  " << violationNames[traces[i].violation] << " from:" << std::endl;
+        out.flush();
+        backtrace_symbols_fd(traces[i].frames, traces[i].depth, STDERR_FILENO);
+    }
+}
+
+}
+
+/*
+ * Interposed entry points, forward to the C library.
+ */
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+
+void *malloc(size_t size)
+{
+    bipscript::RtSafety::check(bipscript::RtSafety::MALLOC);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    bipscript::RtSafety::check(bipscript::RtSafety::CALLOC);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    bipscript::RtSafety::check(bipscript::RtSafety::REALLOC);
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer)
+{
+    if(pointer) {
+        bipscript::RtSafety::check(bipscript::RtSafety::FREE);
+    }
+    __libc_free(pointer);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    typedef int (*LockFunction)(pthread_mutex_t*);
+    static LockFunction next = 0; // no guarded static, its guard may take a mutex
+    if(!next) {
+        next = (LockFunction)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    }
+    bipscript::RtSafety::check(bipscript::RtSafety::MUTEX_LOCK);
+    return next(mutex);
+}
+
+}
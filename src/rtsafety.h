@@ -0,0 +1,73 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RTSAFETY_H
+#define RTSAFETY_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace bipscript {
+
+/**
+ * Detects calls that are not realtime safe made from the process thread and its workers.
+ *
+ * The allocator and mutex entry points are interposed in rtsafety.cpp. While enabled, calls
+ * made inside a process period are counted and the backtraces of the first few are kept.
+ */
+class RtSafety
+{
+public:
+    enum Violation { MALLOC, CALLOC, REALLOC, FREE, MUTEX_LOCK, VIOLATION_TYPES };
+private:
+    static const uint32_t TRACE_LOG = 16;
+    static const int TRACE_DEPTH = 24;
+    struct Trace {
+        Violation violation;
+        int depth;
+        void *frames[TRACE_DEPTH];
+    };
+    std::atomic<bool> enabled;
+    bool tracing;
+    std::atomic<uint64_t> counts[VIOLATION_TYPES];
+    std::atomic<uint32_t> traceCount;
+    Trace traces[TRACE_LOG];
+    // singleton
+    RtSafety();
+    RtSafety(RtSafety const&);
+    void operator=(RtSafety const&);
+public:
+    static RtSafety &instance() {
+        static RtSafety instance;
+        return instance;
+    }
+    void enable(bool tracing);
+    void lockMemory();
+    /**
+     * Mark the calling thread as running a process period, calls can nest.
+     */
+    static void enterProcess();
+    static void leaveProcess();
+    static void check(Violation violation);
+    void record(Violation violation);
+    uint64_t getTotal();
+    void dump(std::ostream &out);
+};
+
+}
+
+#endif // RTSAFETY_H
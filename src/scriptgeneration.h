@@ -0,0 +1,94 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SCRIPTGENERATION_H
+#define SCRIPTGENERATION_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace bipscript {
+
+/**
+ * Counts script runs for seamless restarts.
+ *
+ * Events and graphs carry the generation of the script run that created them. While a rerun
+ * builds the next generation the process thread keeps playing the current one, then swaps
+ * all buffers to the new generation in the same period.
+ */
+class ScriptGeneration
+{
+    std::atomic<uint32_t> running; // script thread -> all
+    std::atomic<uint32_t> completed; // script thread -> process thread
+    std::atomic<uint32_t> playing; // process thread -> all
+    static thread_local bool scriptThread;
+    static thread_local bool mainRun;
+    // singleton
+    ScriptGeneration() : running(0), completed(0), playing(0) {}
+    ScriptGeneration(ScriptGeneration const&);
+    void operator=(ScriptGeneration const&);
+public:
+    static ScriptGeneration &instance() {
+        static ScriptGeneration instance;
+        return instance;
+    }
+    /**
+     * Marks the calling thread as the one running the script.
+     */
+    static void setScriptThread() {
+        scriptThread = true;
+    }
+    /**
+     * Marks whether the calling thread is evaluating the script file, as opposed to running
+     * handlers dispatched later.
+     */
+    static void setMainRun(bool running) {
+        mainRun = running;
+    }
+    static bool inMainRun() {
+        return mainRun;
+    }
+    /**
+     * Generation for a new event, events from other threads belong to the generation playing.
+     */
+    uint32_t forEvent() {
+        return scriptThread ? running.load(std::memory_order_relaxed)
+                            : playing.load(std::memory_order_relaxed);
+    }
+    uint32_t getRunning() { return running.load(); }
+    uint32_t getCompleted() { return completed.load(); }
+    uint32_t getPlaying() { return playing.load(std::memory_order_acquire); }
+    /**
+     * Called before a rerun whose events should be held until the swap.
+     *
+     * Runs in the script thread.
+     */
+    void beginRun() { running.fetch_add(1); }
+    /**
+     * Called when a run is complete and its graph has been published.
+     *
+     * Runs in the script thread.
+     */
+    void completeRun() { completed.store(running.load()); }
+    /**
+     * Runs in the process thread.
+     */
+    void swap(uint32_t generation) { playing.store(generation, std::memory_order_release); }
+};
+
+}
+
+#endif // SCRIPTGENERATION_H
@@ -27,6 +27,9 @@
 #include "scripthost.h"
 #include "extension.h"
 #include "objectcollector.h"
+#include "audioengine.h"
+#include "scriptgeneration.h"
+#include "timeline.h"
 #include <iostream>
 
 namespace bipscript {
@@ -39,7 +42,89 @@ static void squirrel_print_function(HSQUIRRELVM sqvm, const SQChar *format, ...)
     va_end(args);
 }
 
-bool ScriptHost::waitForRestart(HSQOBJECT &context)
+/**
+ * Add a script to run, the name prefixes the system ports it registers.
+ *
+ * Runs in the main thread.
+ */
+void ScriptHost::addScript(const char *folder, const char *filename, const std::string &name)
+{
+    HostedScript script;
+    script.folder = folder;
+    script.filename = filename;
+    script.name = name;
+    script.vm = 0;
+    scripts.push_back(script);
+}
+
+/**
+ * Create a friend VM for the script with a root table of its own that falls back to the
+ * shared root table holding the bindings.
+ *
+ * Runs in the script thread.
+ */
+bool ScriptHost::openScript(HostedScript &script)
+{
+    script.vm = sq_newthread(vm, 1024);
+    if(!script.vm) {
+        return false;
+    }
+    // keep the friend VM alive
+    sq_getstackobj(vm, -1, &script.thread);
+    sq_addref(vm, &script.thread);
+    sq_pop(vm, 1);
+    sqstd_seterrorhandlers(script.vm);
+    sq_newtable(script.vm);
+    sq_pushroottable(script.vm);
+    sq_setdelegate(script.vm, -2);
+    sq_setroottable(script.vm);
+    return true;
+}
+
+/**
+ * Run the main part of every script in order, each with a fresh run table.
+ *
+ * Runs in the script thread.
+ */
+bool ScriptHost::runScripts()
+{
+    // events scheduled by the main runs go on the timelines
+    EventTimelines::instance().clearAll();
+    ScriptGeneration::setMainRun(true);
+    for(HostedScript &script : scripts) {
+        current = &script;
+        // fresh run table
+        sq_newtable(script.vm);
+        sq_getstackobj(script.vm, -1, &script.runTable);
+        sq_addref(script.vm, &script.runTable);
+        bool success = SQ_SUCCEEDED(sqstd_dofile(script.vm, script.filename.c_str(), 0, SQTrue));
+        if(!success) {
+            ScriptGeneration::setMainRun(false);
+            const SQChar *error;
+            sq_getlasterror(script.vm);
+            if (SQ_SUCCEEDED(sq_getstring(script.vm, -1, &error))) {
+                std::cerr << (script.name.empty() ? "" : script.name + ": ") << error << std::endl;
+            }
+            return false;
+        }
+        // pop fresh run table
+        sq_pop(script.vm, 1);
+    }
+    ScriptGeneration::setMainRun(false);
+    return true;
+}
+
+HostedScript *ScriptHost::findScript(HSQUIRRELVM vm)
+{
+    for(HostedScript &script : scripts) {
+        if(script.vm == vm) {
+            return &script;
+        }
+    }
+    return 0;
+}
+
+bool ScriptHost::waitForRestart()
 {
     runningFlag.store(false);
     bool activeObjects = false;
@@ -54,23 +139,46 @@ bool ScriptHost::waitForRestart(HSQOBJECT &context)
     if(!activeObjects) {
         return false;
     }
+    // publish the graph and timelines built by this run
+    AudioEngine::instance().updateGraph();
+    EventTimelines::instance().publishAll();
+    ScriptGeneration::instance().completeRun();
     while(true) {
+        if(stopFlag.load()) {
+            for(HostedScript &script : scripts) {
+                sq_release(script.vm, &script.runTable);
+            }
+            return false;
+        }
         if(restartFlag.load()) {
-            // release fresh run table
-            sq_release(vm, &context);
+            // release fresh run tables
+            for(HostedScript &script : scripts) {
+                sq_release(script.vm, &script.runTable);
+            }
             restartFlag.store(false);
+            if(seamlessFlag.exchange(false)) {
+                ScriptGeneration::instance().beginRun();
+            }
             runningFlag.store(true);
             return true;
         }
-        // run any dispatched methods
+        // run any dispatched methods in the script that created them
         ScriptFunctionClosure *closure = MethodQueue::instance().next();
         while(closure) {
-            closure->execute(context);
+            current = findScript(closure->getVM());
+            if(current) {
+                closure->execute(current->runTable);
+            }
             closure->recycle();
             closure = MethodQueue::instance().next();
         }
-        // free collected objects
-        ObjectCollector::scriptCollector().free();
+        // handlers may have changed connections
+        AudioEngine::instance().updateGraph();
+        // report requested by signal
+        AudioEngine::instance().getDeadlineMonitor().dumpIfRequested(std::cerr);
+        AudioEngine::instance().dumpGraphIfRequested();
+        // hand back process-allocated closures held while the queue was full
+        ObjectCollector::processCollector().update(ObjectCollector::PERIOD_BUDGET);
         // sleep
         struct timespec req = {0, 25000};
         while(nanosleep(&req,&req)==-1) {
@@ -79,7 +187,14 @@ bool ScriptHost::waitForRestart(HSQOBJECT &context)
     }
 }
 
+/**
+ * Run the scripts until none of them has active objects. All scripts share the bindings and
+ * run on this thread, the caches and queues of the engine belong to the script thread.
+ *
+ * Runs in the script thread.
+ */
 int ScriptHost::run() {
+    ScriptGeneration::setScriptThread();
     // init squirrel
     vm = sq_open(1024);
     // set print function
@@ -103,30 +218,29 @@ int ScriptHost::run() {
     // pop root table
     sq_pop(vm, 1);
 
+    // one friend VM per script
+    for(HostedScript &script : scripts) {
+        if(!openScript(script)) {
+            std::cerr << "error: could not create a VM for " << script.filename << std::endl;
+            return 1;
+        }
+    }
+
     bool rerun = true;
     while(rerun) {
-        // fresh run table
-        HSQOBJECT freshRunTable;
-        sq_newtable(vm);
-        sq_getstackobj(vm,-1,&freshRunTable);
-        sq_addref(vm, &freshRunTable);
-        if(!SQ_SUCCEEDED(sqstd_dofile(vm, filename, 0, SQTrue))) {
-            const SQChar *error;
-            sq_getlasterror(vm);
-            if (SQ_SUCCEEDED(sq_getstring(vm, -1, &error))) {
-                std::cerr << error << std::endl;
-            }
+        if(!runScripts()) {
             return 1;
         }
-        // pop fresh run table
-        sq_pop(vm, 1);
-
         // wait for restart
-        rerun = waitForRestart(freshRunTable);
+        rerun = waitForRestart();
     }
     // shut down extensions
     ExtensionManager::instance().shutdown();
     // shut down squirrel
+    for(HostedScript &script : scripts) {
+        sq_release(vm, &script.thread);
+    }
+    current = 0;
     sq_close(vm);
     return 0;
 }
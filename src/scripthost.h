@@ -19,6 +19,8 @@
 
 #include <list>
 #include <atomic>
+#include <string>
+#include <vector>
 #include "squirrel.h"
 
 #include "scripttypes.h"
@@ -27,11 +29,24 @@
 
 namespace bipscript {
 
+/**
+ * One script of the session with its own root table, globals set by the script stay
+ * out of the other scripts.
+ */
+struct HostedScript {
+    std::string folder;
+    std::string filename;
+    std::string name; // prefix of the system ports, empty for a single script
+    HSQUIRRELVM vm;
+    HSQOBJECT thread;
+    HSQOBJECT runTable;
+};
+
 class ScriptHost
 {
     HSQUIRRELVM vm;
-    std::string folder;
-    const char *filename;
+    std::vector<HostedScript> scripts;
+    HostedScript *current;
 
     // object caches
     uint16_t objectCacheCount;
@@ -39,10 +54,12 @@ class ScriptHost
 
     // script thread communication
     std::atomic<bool> restartFlag;
+    std::atomic<bool> seamlessFlag;
     std::atomic<bool> runningFlag;
+    std::atomic<bool> stopFlag;
 
     // singleton
-    ScriptHost() : restartFlag(false), runningFlag(true)  {}
+    ScriptHost() : current(0), restartFlag(false), seamlessFlag(false), runningFlag(true), stopFlag(false)  {}
     ScriptHost(ScriptHost const&) = delete;
     void operator=(ScriptHost const&);
 public:
@@ -51,23 +68,45 @@ public:
         return instance;
     }
     void setScriptFile(const char *folder, const char *filename) {
-        this->folder = folder;
-        this->filename = filename;
+        addScript(folder, filename, "");
     }
+    void addScript(const char *folder, const char *filename, const std::string &name);
     void setObjectCaches(uint16_t count, ObjectCache *list[]) {
         objectCacheCount = count;
         objectCacheList = list;
     }
     std::string &getCurrentFolder() {
-        return folder;
+        return current->folder;
+    }
+    /**
+     * Name of a system port for the script that is running, prefixed in a session.
+     *
+     * Runs in the script thread.
+     */
+    std::string portName(const char *name) {
+        if(!current || current->name.empty()) {
+            return name;
+        }
+        return current->name + "." + name;
     }
     int run();
     bool running() { return runningFlag.load(); }
     void restart() { restartFlag.store(true); }
+    /**
+     * Rerun the script as a new generation while the current one keeps playing.
+     */
+    void restartSeamless() {
+        seamlessFlag.store(true);
+        restartFlag.store(true);
+    }
+    void stop() { stopFlag.store(true); }
 private:
     void objectReposition(bool final);
     void bindModules(HSQUIRRELVM vm);
-    bool waitForRestart(HSQOBJECT &context);
+    bool openScript(HostedScript &script);
+    bool runScripts();
+    HostedScript *findScript(HSQUIRRELVM vm);
+    bool waitForRestart();
 };
 
 }
@@ -87,6 +87,9 @@ public:
     uint32_t getNumargs() {
         return numargs;
     }
+    HSQUIRRELVM getVM() {
+        return vm;
+    }
     void release() {
         sq_release(vm, &function);
     }
@@ -95,8 +98,9 @@ public:
 class ScriptFunctionClosure : public ScriptFunction
 {
 public:
+    ScriptFunctionClosure *nextDispatched; // held by a process worker
     ScriptFunctionClosure(ScriptFunction &function) :
-        ScriptFunction(function) {}
+        ScriptFunction(function), nextDispatched(0) {}
     bool execute(HSQOBJECT &context);
     void dispatch() {
         MethodQueue::instance().dispatch(this);
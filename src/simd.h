@@ -0,0 +1,285 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace bipscript {
+namespace simd {
+
+#if defined(__GNUC__)
+// four floats, compiled to SSE, NEON or scalar code depending on the target
+typedef float Float4 __attribute__((vector_size(16)));
+
+inline Float4 load(const float *address) {
+    Float4 value;
+    memcpy(&value, address, sizeof(Float4));
+    return value;
+}
+
+inline void store(float *address, Float4 value) {
+    memcpy(address, &value, sizeof(Float4));
+}
+
+typedef int32_t Int4 __attribute__((vector_size(16)));
+
+inline Float4 magnitude(Float4 value) {
+    Int4 mask = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+    return (Float4)((Int4)value & mask);
+}
+
+inline Float4 maximum(Float4 a, Float4 b) {
+    Int4 greater = a > b;
+    return (Float4)(((Int4)a & greater) | ((Int4)b & ~greater));
+}
+#endif
+
+// the 48 tap interpolation filter of ITU-R BS.1770-4 annex 2 that oversamples four times to
+// find peaks between samples: the weight of each of the last 12 samples, oldest first, in
+// each of the four phases
+const int INTERSAMPLE_TAPS = 12;
+const float INTERSAMPLE_WEIGHTS[INTERSAMPLE_TAPS][4] = {
+    { 0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f },
+    { 0.0109863281250f, 0.0292968750000f, 0.0330810546875f, 0.0148925781250f },
+    { -0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f },
+    { 0.0332031250000f, 0.0891113281250f, 0.1015625000000f, 0.0476074218750f },
+    { -0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f },
+    { 0.1373291015625f, 0.4650878906250f, 0.7797851562500f, 0.9721679687500f },
+    { 0.9721679687500f, 0.7797851562500f, 0.4650878906250f, 0.1373291015625f },
+    { -0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f },
+    { 0.0476074218750f, 0.1015625000000f, 0.0891113281250f, 0.0332031250000f },
+    { -0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f },
+    { 0.0148925781250f, 0.0330810546875f, 0.0292968750000f, 0.0109863281250f },
+    { -0.0083007812500f, -0.0189208984375f, -0.0291748046875f, 0.0017089843750f }
+};
+
+/**
+ * Running peak, sum of squares and peak between samples of a signal, the last samples are
+ * kept so peaks between samples are found across calls.
+ */
+struct Levels
+{
+    float peak;
+    float squares;
+    float truePeak;
+    float history[INTERSAMPLE_TAPS - 1];
+};
+
+/**
+ * Add one sample to the levels.
+ *
+ * Runs in the process thread.
+ */
+inline void addSample(Levels &levels, float sample)
+{
+    float level = std::fabs(sample);
+    if(level > levels.peak) {
+        levels.peak = level;
+    }
+    levels.squares += sample * sample;
+    float *history = levels.history;
+    for(int phase = 0; phase < 4; phase++) {
+        float between = INTERSAMPLE_WEIGHTS[INTERSAMPLE_TAPS - 1][phase] * sample;
+        for(int tap = 0; tap < INTERSAMPLE_TAPS - 1; tap++) {
+            between += INTERSAMPLE_WEIGHTS[tap][phase] * history[tap];
+        }
+        between = std::fabs(between);
+        if(between > levels.truePeak) {
+            levels.truePeak = between;
+        }
+    }
+    memmove(history, history + 1, (INTERSAMPLE_TAPS - 2) * sizeof(float));
+    history[INTERSAMPLE_TAPS - 2] = sample;
+}
+
+#if defined(__GNUC__)
+/**
+ * Levels of a signal added four samples at a time and folded back into the scalar levels
+ * at the end.
+ */
+class BlockLevels
+{
+    Float4 peaks;
+    Float4 squares;
+    Float4 truePeaks;
+    float window[INTERSAMPLE_TAPS + 3]; // the history, then the block
+public:
+    BlockLevels(const Levels &levels) {
+        peaks = Float4{ levels.peak, 0, 0, 0 };
+        squares = Float4{ levels.squares, 0, 0, 0 };
+        truePeaks = Float4{ levels.truePeak, 0, 0, 0 };
+        memcpy(window, levels.history, sizeof(levels.history));
+    }
+    void add(Float4 samples) {
+        store(window + INTERSAMPLE_TAPS - 1, samples);
+        peaks = maximum(peaks, magnitude(samples));
+        squares += samples * samples;
+        // all four phases after each sample, reading single samples from the window as
+        // wider loads of the samples just stored there stall, in three sums to shorten the
+        // chain of additions
+        const float (*weight)[4] = INTERSAMPLE_WEIGHTS;
+        for(int frame = 0; frame < 4; frame++) {
+            const float *x = window + frame;
+            Float4 early = load(weight[0]) * x[0] + load(weight[1]) * x[1]
+                    + load(weight[2]) * x[2] + load(weight[3]) * x[3];
+            Float4 middle = load(weight[4]) * x[4] + load(weight[5]) * x[5]
+                    + load(weight[6]) * x[6] + load(weight[7]) * x[7];
+            Float4 late = load(weight[8]) * x[8] + load(weight[9]) * x[9]
+                    + load(weight[10]) * x[10] + load(weight[11]) * x[11];
+            truePeaks = maximum(truePeaks, magnitude(early + middle + late));
+        }
+        for(int tap = 0; tap < INTERSAMPLE_TAPS - 1; tap++) {
+            window[tap] = window[tap + 4];
+        }
+    }
+    void finish(Levels &levels) {
+        float lanes[3][4];
+        store(lanes[0], peaks);
+        store(lanes[1], squares);
+        store(lanes[2], truePeaks);
+        levels.peak = std::fmax(std::fmax(lanes[0][0], lanes[0][1]), std::fmax(lanes[0][2], lanes[0][3]));
+        levels.squares = lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+        levels.truePeak = std::fmax(std::fmax(lanes[2][0], lanes[2][1]), std::fmax(lanes[2][2], lanes[2][3]));
+        memcpy(levels.history, window, sizeof(levels.history));
+    }
+};
+#endif
+
+/**
+ * Add a buffer to the levels, for signals that are not mixed.
+ *
+ * Runs in the process thread.
+ */
+inline void measure(Levels &levels, const float *samples, uint32_t frames)
+{
+    uint32_t frame = 0;
+#if defined(__GNUC__)
+    BlockLevels block(levels);
+    for(; frame + 4 <= frames; frame += 4) {
+        block.add(load(samples + frame));
+    }
+    block.finish(levels);
+#endif
+    for(; frame < frames; frame++) {
+        addSample(levels, samples[frame]);
+    }
+}
+
+/**
+ * Add silence to the levels without reading a buffer.
+ *
+ * Runs in the process thread.
+ */
+inline void measureSilence(Levels &levels, uint32_t frames)
+{
+    for(uint32_t frame = 0; frame < frames && frame < INTERSAMPLE_TAPS - 1; frame++) {
+        addSample(levels, 0);
+    }
+}
+
+/**
+ * Add the input times the gain to the output, buffers need not be aligned.
+ *
+ * Runs in the process thread.
+ */
+inline void multiplyAdd(float *output, const float *input, float gain, uint32_t frames)
+{
+    uint32_t frame = 0;
+#if defined(__GNUC__)
+    Float4 gains = { gain, gain, gain, gain };
+    for(; frame + 4 <= frames; frame += 4) {
+        store(output + frame, load(output + frame) + load(input + frame) * gains);
+    }
+#endif
+    for(; frame < frames; frame++) {
+        output[frame] += input[frame] * gain;
+    }
+}
+
+/**
+ * Add the input times a gain that starts at the given value and changes by step every
+ * frame to the output, buffers need not be aligned.
+ *
+ * Runs in the process thread.
+ */
+inline void multiplyAddRamp(float *output, const float *input, float gain, float step, uint32_t frames)
+{
+    uint32_t frame = 0;
+#if defined(__GNUC__)
+    Float4 gains = { gain, gain + step, gain + 2 * step, gain + 3 * step };
+    Float4 steps = { 4 * step, 4 * step, 4 * step, 4 * step };
+    for(; frame + 4 <= frames; frame += 4) {
+        store(output + frame, load(output + frame) + load(input + frame) * gains);
+        gains += steps;
+    }
+#endif
+    for(; frame < frames; frame++) {
+        output[frame] += input[frame] * (gain + step * frame);
+    }
+}
+
+/**
+ * Add the input times the gain to the output like multiplyAdd, and add the input or the
+ * mixed output to their levels in the same pass.
+ *
+ * Runs in the process thread.
+ */
+template <bool INPUT, bool OUTPUT>
+inline void multiplyAddMeasure(float *output, const float *input, float gain, uint32_t frames,
+                               Levels *inputLevels, Levels *outputLevels)
+{
+    uint32_t frame = 0;
+#if defined(__GNUC__)
+    Float4 gains = { gain, gain, gain, gain };
+    Levels unused = Levels();
+    BlockLevels inputBlock(INPUT ? *inputLevels : unused);
+    BlockLevels outputBlock(OUTPUT ? *outputLevels : unused);
+    for(; frame + 4 <= frames; frame += 4) {
+        Float4 in = load(input + frame);
+        Float4 out = load(output + frame) + in * gains;
+        store(output + frame, out);
+        if(INPUT) {
+            inputBlock.add(in);
+        }
+        if(OUTPUT) {
+            outputBlock.add(out);
+        }
+    }
+    if(INPUT) {
+        inputBlock.finish(*inputLevels);
+    }
+    if(OUTPUT) {
+        outputBlock.finish(*outputLevels);
+    }
+#endif
+    for(; frame < frames; frame++) {
+        output[frame] += input[frame] * gain;
+        if(INPUT) {
+            addSample(*inputLevels, input[frame]);
+        }
+        if(OUTPUT) {
+            addSample(*outputLevels, output[frame]);
+        }
+    }
+}
+
+}}
+
+#endif // SIMD_H
@@ -0,0 +1,226 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "simulateddriver.h"
+#include "audioengine.h"
+#include "scripthost.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace bipscript {
+
+/**
+ * Parse a comma separated list of <period>:<action> entries where the action is start, stop,
+ * locate=<frame>, xrun[=<periods>], tone=<Hz> or cc=<channel>/<controller>/<value>.
+ *
+ * Returns false if the sequence is invalid.
+ */
+bool SimulatedDriver::setSequence(const char *sequence)
+{
+    actions.clear();
+    std::stringstream stream(sequence);
+    std::string entry;
+    while(std::getline(stream, entry, ',')) {
+        char *end;
+        Action action;
+        action.period = strtoul(entry.c_str(), &end, 10);
+        if(end == entry.c_str() || *end != ':') {
+            return false;
+        }
+        std::string name(end + 1);
+        std::string argument;
+        size_t equals = name.find('=');
+        if(equals != std::string::npos) {
+            argument = name.substr(equals + 1);
+            name = name.substr(0, equals);
+        }
+        action.value = argument.empty() ? 1 : strtoul(argument.c_str(), 0, 10);
+        if(name == "start") {
+            action.type = Action::START;
+        } else if(name == "stop") {
+            action.type = Action::STOP;
+        } else if(name == "locate" && !argument.empty()) {
+            action.type = Action::LOCATE;
+        } else if(name == "xrun" && action.value) {
+            action.type = Action::XRUN;
+        } else if(name == "tone" && !argument.empty()) {
+            action.type = Action::TONE;
+        } else if(name == "cc") {
+            unsigned int channel, controller, value;
+            char extra;
+            if(sscanf(argument.c_str(), "%u/%u/%u%c", &channel, &controller, &value, &extra) != 3
+                    || channel < 1 || channel > 16 || controller > 127 || value > 127) {
+                return false;
+            }
+            action.type = Action::CONTROL;
+            action.message[0] = 0xb0 | (channel - 1);
+            action.message[1] = controller;
+            action.message[2] = value;
+        } else {
+            return false;
+        }
+        actions.push_back(action);
+    }
+    std::stable_sort(actions.begin(), actions.end(),
+                     [](const Action &a, const Action &b) { return a.period < b.period; });
+    return true;
+}
+
+/**
+ * Wait until the script has been evaluated, then run the configured number of periods back to
+ * back applying the sequence and timing each period.
+ */
+void SimulatedDriver::run()
+{
+    // no periods run while the script is evaluated so every run starts from the same state
+    while(!stopped.load() && ScriptHost::instance().running()) {
+        usleep(1000);
+    }
+    durations.reserve(periodCount);
+
+    jack_position_t pos;
+    uint32_t xruns = 0;
+    auto next = actions.begin();
+    for(uint32_t period = 0; period < periodCount && !stopped.load(); period++) {
+        uint32_t skip = 0;
+        clearInputs();
+        for(; next != actions.end() && next->period == period; next++) {
+            switch(next->type) {
+            case Action::START:
+                transportStart();
+                break;
+            case Action::STOP:
+                transportStop();
+                break;
+            case Action::LOCATE:
+                transportLocate(next->value);
+                break;
+            case Action::XRUN:
+                skip += next->value;
+                break;
+            case Action::TONE:
+                toneFrequency = next->value;
+                break;
+            case Action::CONTROL:
+                sendControl(next->message);
+                break;
+            }
+        }
+        if(skip) {
+            // missed periods take the place of this one
+            for(uint32_t i = 0; i < skip; i++) {
+                skipPeriod();
+            }
+            AudioEngine::instance().xrun();
+            xruns++;
+            continue;
+        }
+        playTone();
+        auto start = std::chrono::steady_clock::now();
+        runPeriod(pos);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        durations.push_back(elapsed.count());
+    }
+    report(xruns);
+    ScriptHost::instance().stop();
+}
+
+/**
+ * Empty the MIDI inputs and silence the audio inputs before a period.
+ */
+void SimulatedDriver::clearInputs()
+{
+    std::lock_guard<std::mutex> lock(portMutex);
+    for(MemoryPort *port : ports) {
+        if(port->getType() == DriverPort::MIDI_INPUT) {
+            port->clearMidiBuffer(0);
+        } else if(port->getType() == DriverPort::AUDIO_INPUT) {
+            std::fill(port->getAudio(), port->getAudio() + getBufferSize(), 0.0f);
+        }
+    }
+}
+
+/**
+ * Add a controller message at the start of the period to every MIDI input.
+ */
+void SimulatedDriver::sendControl(const unsigned char *message)
+{
+    std::lock_guard<std::mutex> lock(portMutex);
+    for(MemoryPort *port : ports) {
+        if(port->getType() == DriverPort::MIDI_INPUT) {
+            jack_midi_data_t *data = port->reserveMidiEvent(0, 0, 3);
+            if(data) {
+                std::copy(message, message + 3, data);
+            }
+        }
+    }
+}
+
+/**
+ * Write a period of the current tone to every audio input. The sine starts at 45 degrees
+ * so a tone at a quarter of the sample rate has samples at +-0.707 while its true peak is 1.
+ */
+void SimulatedDriver::playTone()
+{
+    if(!toneFrequency) {
+        return;
+    }
+    jack_nframes_t frames = getBufferSize();
+    double step = 2 * M_PI * toneFrequency / getSampleRate();
+    std::lock_guard<std::mutex> lock(portMutex);
+    for(MemoryPort *port : ports) {
+        if(port->getType() == DriverPort::AUDIO_INPUT) {
+            float *audio = port->getAudio();
+            for(jack_nframes_t i = 0; i < frames; i++) {
+                audio[i] = std::sin(step * (toneFrame + i) + M_PI / 4);
+            }
+        }
+    }
+    toneFrame += frames;
+}
+
+void SimulatedDriver::report(uint32_t xruns)
+{
+    if(durations.empty()) {
+        std::cerr << "simulated " << xruns << " xruns, no periods processed" << std::endl;
+        return;
+    }
+    double total = 0;
+    for(double duration : durations) {
+        total += duration;
+    }
+    std::vector<double> sorted(durations);
+    std::sort(sorted.begin(), sorted.end());
+    double periodLength = 1000000.0 * getBufferSize() / getSampleRate();
+    double mean = total / sorted.size();
+    double p99 = sorted[(sorted.size() - 1) * 99 / 100];
+    std::cerr << "simulated " << sorted.size() << " periods of " << getBufferSize() << " frames at "
+              << getSampleRate() << " Hz, " << xruns << " injected xruns" << std::endl;
+    std::cerr << "period time us: min " << sorted.front() << " mean " << mean << " p99 " << p99
+              << " max " << sorted.back() << std::endl;
+    std::cerr << "mean load " << 100 * mean / periodLength << "% of " << periodLength
+              << "us period, " << periodLength * sorted.size() / total << "x realtime" << std::endl;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SIMULATEDDRIVER_H
+#define SIMULATEDDRIVER_H
+
+#include "offlinedriver.h"
+
+#include <vector>
+
+namespace bipscript {
+
+/**
+ * Drives the engine period by period in a tight loop with a simulated clock, for reproducible
+ * timing without a server.
+ *
+ * Transport changes and xruns are injected at fixed periods from a sequence such as
+ * "0:start,400:locate=96000,500:xrun=2,800:stop". The sequence can also play a sine into the
+ * system audio inputs (tone=<Hz>, tone=0 for silence) and send a controller to the system
+ * MIDI inputs (cc=<channel>/<controller>/<value>). Times the engine for every period and
+ * prints a summary when done.
+ */
+class SimulatedDriver : public OfflineDriver
+{
+    struct Action {
+        enum Type { START, STOP, LOCATE, XRUN, TONE, CONTROL };
+        uint32_t period;
+        Type type;
+        uint32_t value;
+        unsigned char message[3];
+    };
+    uint32_t periodCount;
+    std::vector<Action> actions;
+    std::vector<double> durations; // microseconds, allocated before the loop
+    uint32_t toneFrequency;
+    uint64_t toneFrame;
+    void clearInputs();
+    void sendControl(const unsigned char *message);
+    void playTone();
+    void report(uint32_t xruns);
+public:
+    SimulatedDriver(uint32_t periodCount, jack_nframes_t sampleRate, jack_nframes_t bufferSize)
+        : OfflineDriver(sampleRate, bufferSize), periodCount(periodCount), toneFrequency(0), toneFrame(0) {}
+    bool setSequence(const char *sequence);
+    void run();
+};
+
+}
+
+#endif // SIMULATEDDRIVER_H
@@ -18,12 +18,15 @@
 #define SOURCE_H
 
 #include "processor.h"
+#include "connectionindex.h"
 
 namespace bipscript {
 
 class AbstractSource : public Processor {
 public:
-    virtual bool connectsTo(AbstractSource *) = 0;
+    virtual ~AbstractSource() {
+        ConnectionIndex::instance().forget(this);
+    }
 };
 
 }
@@ -16,6 +16,14 @@
  */
 
 #include "systempackage.h"
+#include "audioengine.h"
+#include "bufferpool.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 namespace bipscript {
 namespace system {
@@ -23,5 +31,55 @@ namespace system {
 int System::argumentCount;
 char **System::argumentVector;
 
+/**
+ * Bytes of audio buffer memory the current process graph saves by sharing pooled buffers
+ * compared with one buffer per connection.
+ *
+ * Runs in the script thread.
+ */
+long System::getBufferSavings()
+{
+    return audio::BufferPool::instance().getBytesSaved();
+}
+
+/**
+ * Table of the time each processor took per period since the last call, in microseconds.
+ *
+ * Runs in the script thread.
+ */
+const char *System::getDspLoad()
+{
+    static std::string report;
+    std::vector<ProcessorLoadEntry> entries;
+    AudioEngine::instance().collectLoad(entries);
+    report = "periods      min      avg      max      p95  processor\n";
+    for(ProcessorLoadEntry &entry : entries) {
+        char line[64];
+        LoadStats &stats = entry.stats;
+        snprintf(line, sizeof(line), "%7lu %8.1f %8.1f %8.1f %8.1f  ", (unsigned long)stats.periods,
+                 stats.minimum, stats.average, stats.maximum, stats.percentile95);
+        report += line + entry.label + "\n";
+    }
+    return report.c_str();
+}
+
+/**
+ * The processor graph as "dot" or "json".
+ *
+ * Runs in the script thread.
+ */
+const char *System::getGraph(const char *format)
+{
+    static std::string report;
+    bool json = !strcmp(format, "json");
+    if(!json && strcmp(format, "dot")) {
+        throw std::logic_error(std::string("unknown graph format: ") + format);
+    }
+    std::ostringstream out;
+    AudioEngine::instance().describeGraph(out, json);
+    report = out.str();
+    return report.c_str();
+}
+
 }
 }
\ No newline at end of file
@@ -35,6 +35,12 @@ public:
         }
         return argumentVector[index];
     }
+    static long getBufferSavings();
+    static const char *getDspLoad();
+    static const char *getGraph(const char *format);
+    static const char *getGraph() {
+        return getGraph("dot");
+    }
 };
 
 }}
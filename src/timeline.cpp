@@ -0,0 +1,48 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timeline.h"
+
+namespace bipscript {
+
+/**
+ * Retire the timelines of all buffers, the main run that follows schedules them again.
+ *
+ * Runs in the script thread.
+ */
+void EventTimelines::clearAll()
+{
+    for(TimelineOwner *owner : owners) {
+        owner->clearTimeline();
+        changed.insert(owner);
+    }
+}
+
+/**
+ * Publish the timelines of all buffers that received events since the last flush.
+ *
+ * Runs in the script thread.
+ */
+void EventTimelines::publishAll()
+{
+    for(TimelineOwner *owner : changed) {
+        owner->publishTimeline();
+    }
+    changed.clear();
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+
+namespace bipscript {
+
+/**
+ * Immutable sorted array of the events scheduled by the main script run for one event buffer,
+ * built in the script thread and read by the process thread through a cursor.
+ */
+template <class T> struct TimelineSnapshot
+{
+    uint32_t serial;
+    uint32_t size;
+    T **events;
+    TimelineSnapshot(uint32_t serial, uint32_t size) : serial(serial), size(size) {
+        events = new T*[size ? size : 1];
+    }
+    ~TimelineSnapshot() { delete[] events; }
+};
+
+/**
+ * Event buffer side of the timeline registry.
+ */
+class TimelineOwner
+{
+public:
+    /**
+     * Publish the timeline changed since the last call to the process thread.
+     *
+     * Runs in the script thread.
+     */
+    virtual void publishTimeline() = 0;
+    /**
+     * Retire all events on the timeline ahead of a new main script run.
+     *
+     * Runs in the script thread.
+     */
+    virtual void clearTimeline() = 0;
+    virtual ~TimelineOwner() {}
+};
+
+/**
+ * Keeps track of event buffers with unpublished timeline changes.
+ *
+ * When enabled, events scheduled by the main script run stay in the timeline of their buffer
+ * after being played so a relocation only moves the cursors and the script does not rerun.
+ */
+class EventTimelines
+{
+    bool enabled;
+    std::set<TimelineOwner*> owners; // script thread
+    std::set<TimelineOwner*> changed; // script thread
+    // singleton
+    EventTimelines() : enabled(false) {}
+    EventTimelines(EventTimelines const&);
+    void operator=(EventTimelines const&);
+public:
+    static EventTimelines &instance() {
+        static EventTimelines instance;
+        return instance;
+    }
+    void setEnabled(bool enabled) {
+        this->enabled = enabled;
+    }
+    bool isEnabled() {
+        return enabled;
+    }
+    void markChanged(TimelineOwner *owner) {
+        owners.insert(owner);
+        changed.insert(owner);
+    }
+    void forget(TimelineOwner *owner) {
+        owners.erase(owner);
+        changed.erase(owner);
+    }
+    void clearAll();
+    void publishAll();
+};
+
+}
+
+#endif // TIMELINE_H
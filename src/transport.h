@@ -47,7 +47,11 @@ public:
     {
         nparams = function.getNumargs();
     }
-    void recycle() { delete this; }
+    void recycle() {
+        if(!onTimeline()) {
+            delete this;
+        }
+    }
 };
 
 class Transport : public Processor
@@ -70,7 +74,9 @@ public:
     }
     void schedule(ScriptFunction &function, unsigned int bar, unsigned int position, unsigned int division);
     void doProcess(bool, jack_position_t&, jack_nframes_t, jack_nframes_t);
+    std::string getLabel() { return "Transport"; }
     void reposition() { eventBuffer.recycleRemaining(); }
+    void relocate() { eventBuffer.relocate(); }
     bool repositionComplete() { return true; }
 };
 
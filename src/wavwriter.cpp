@@ -0,0 +1,118 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wavwriter.h"
+
+#include <stdexcept>
+
+namespace bipscript {
+namespace audio {
+
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+const long FACT_COUNT_OFFSET = 46;
+const long DATA_SIZE_OFFSET = 54;
+const uint32_t HEADER_SIZE = 58;
+
+static void writeTag(FILE *file, const char *tag)
+{
+    fwrite(tag, 1, 4, file);
+}
+
+static void write16(FILE *file, uint16_t value)
+{
+    uint8_t bytes[] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    fwrite(bytes, 1, 2, file);
+}
+
+static void write32(FILE *file, uint32_t value)
+{
+    uint8_t bytes[] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    fwrite(bytes, 1, 4, file);
+}
+
+WavWriter::WavWriter(const std::string &path, uint32_t sampleRate)
+    : frameCount(0)
+{
+    file = fopen(path.c_str(), "wb");
+    if(!file) {
+        throw std::runtime_error("cannot open " + path + " for writing");
+    }
+    writeHeader(sampleRate);
+}
+
+/**
+ * Write the header with a fmt chunk for IEEE float, the sizes are patched on close.
+ */
+void WavWriter::writeHeader(uint32_t sampleRate)
+{
+    writeTag(file, "RIFF");
+    write32(file, 0);
+    writeTag(file, "WAVE");
+    // format
+    writeTag(file, "fmt ");
+    write32(file, 18);
+    write16(file, WAVE_FORMAT_IEEE_FLOAT);
+    write16(file, 1); // channels
+    write32(file, sampleRate);
+    write32(file, sampleRate * sizeof(float));
+    write16(file, sizeof(float)); // block align
+    write16(file, 32); // bits per sample
+    write16(file, 0); // extension size
+    // sample count, required for non-PCM formats
+    writeTag(file, "fact");
+    write32(file, 4);
+    write32(file, 0);
+    // samples
+    writeTag(file, "data");
+    write32(file, 0);
+}
+
+void WavWriter::write(const float *audio, uint32_t nframes)
+{
+    for(uint32_t i = 0; i < nframes; i++) {
+        union { float f; uint32_t i; } sample;
+        sample.f = audio[i];
+        write32(file, sample.i);
+    }
+    frameCount += nframes;
+}
+
+void WavWriter::writeSilence(uint32_t nframes)
+{
+    for(uint32_t i = 0; i < nframes; i++) {
+        write32(file, 0);
+    }
+    frameCount += nframes;
+}
+
+void WavWriter::close()
+{
+    if(!file) {
+        return;
+    }
+    uint32_t dataSize = frameCount * sizeof(float);
+    fseek(file, 4, SEEK_SET);
+    write32(file, HEADER_SIZE - 8 + dataSize);
+    fseek(file, FACT_COUNT_OFFSET, SEEK_SET);
+    write32(file, frameCount);
+    fseek(file, DATA_SIZE_OFFSET, SEEK_SET);
+    write32(file, dataSize);
+    fclose(file);
+    file = 0;
+}
+
+}}
@@ -0,0 +1,45 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WAVWRITER_H
+#define WAVWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace bipscript {
+namespace audio {
+
+/**
+ * Writes a mono 32 bit float WAV file.
+ */
+class WavWriter
+{
+    FILE *file;
+    uint32_t frameCount;
+    void writeHeader(uint32_t sampleRate);
+public:
+    WavWriter(const std::string &path, uint32_t sampleRate);
+    ~WavWriter() { close(); }
+    void write(const float *audio, uint32_t nframes);
+    void writeSilence(uint32_t nframes);
+    void close();
+};
+
+}}
+
+#endif // WAVWRITER_H
@@ -0,0 +1,42 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WORKERINDEX_H
+#define WORKERINDEX_H
+
+#include <cstdint>
+
+namespace bipscript {
+
+/**
+ * Index of the process worker running on the calling thread, zero on the process thread and
+ * on every thread that is not a process worker.
+ *
+ * Shared state that only the process thread may touch keeps one slot per worker, the slots
+ * are merged by the process thread after the workers have joined.
+ */
+class WorkerIndex
+{
+    static thread_local uint16_t index;
+public:
+    static const uint16_t MAX_WORKERS = 64;
+    static uint16_t current() { return index; }
+    static void set(uint16_t worker) { index = worker; }
+};
+
+}
+
+#endif // WORKERINDEX_H
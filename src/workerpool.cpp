@@ -0,0 +1,165 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+#include "rtsafety.h"
+#include "memorypool.h"
+#include "methodqueue.h"
+#include "objectcollector.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace bipscript {
+
+thread_local uint16_t WorkerIndex::index = 0;
+MemoryPool *MemoryPool::workerPools[WorkerIndex::MAX_WORKERS] = {};
+
+/**
+ * Give each process worker its own closure pool, the same size as the process pool.
+ *
+ * Runs in the main thread before the workers start.
+ */
+void MemoryPool::createWorkerPools(uint16_t workers, size_t size)
+{
+    for(uint16_t worker = 1; worker <= workers; worker++) {
+        workerPools[worker] = new MemoryPool(size);
+    }
+}
+
+void *run_process_worker(void *arg)
+{
+    ProcessWorker *worker = (ProcessWorker*)arg;
+    worker->pool->work(worker);
+    return 0;
+}
+
+/**
+ * Create the worker threads, with realtime scheduling if a priority is given.
+ *
+ * Runs in the main thread before the script starts.
+ */
+void WorkerPool::start(uint16_t count, int priority)
+{
+    // more workers than cores would only spin against each other
+    unsigned int cores = std::thread::hardware_concurrency();
+    if(cores && count >= cores) {
+        std::cerr << "warning: limiting process workers to " << cores - 1 << std::endl;
+        count = cores - 1;
+    }
+    if(count >= WorkerIndex::MAX_WORKERS) {
+        count = WorkerIndex::MAX_WORKERS - 1;
+    }
+    if(!count) {
+        return;
+    }
+    MemoryPool::createWorkerPools(count, 32768);
+    workers = new ProcessWorker[count];
+    for(uint16_t i = 0; i < count; i++) {
+        ProcessWorker &worker = workers[i];
+        worker.pool = this;
+        worker.index = i + 1; // process thread is worker zero
+        sem_init(&worker.start, 0, 0);
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        if(priority > 0) {
+            sched_param param;
+            param.sched_priority = priority;
+            pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+            pthread_attr_setschedparam(&attributes, &param);
+        }
+        int result = pthread_create(&worker.thread, &attributes, run_process_worker, &worker);
+        if(result && priority > 0) {
+            std::cerr << "warning: could not create realtime process worker, using normal priority" << std::endl;
+            result = pthread_create(&worker.thread, 0, run_process_worker, &worker);
+        }
+        pthread_attr_destroy(&attributes);
+        if(result) {
+            throw std::runtime_error("could not create process worker thread");
+        }
+    }
+    workerCount = count;
+}
+
+/**
+ * Wake and join the worker threads.
+ *
+ * Runs in the main thread after the audio engine has been deactivated.
+ */
+void WorkerPool::stop()
+{
+    cancelled.store(true);
+    for(uint16_t i = 0; i < workerCount; i++) {
+        sem_post(&workers[i].start);
+    }
+    for(uint16_t i = 0; i < workerCount; i++) {
+        pthread_join(workers[i].thread, 0);
+        sem_destroy(&workers[i].start);
+    }
+    delete[] workers;
+    workers = 0;
+    workerCount = 0;
+}
+
+/**
+ * Process one period of the given graph on all workers, returns when every node has run.
+ *
+ * Runs in the process thread.
+ */
+void WorkerPool::run(ProcessGraph *graph, bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time)
+{
+    this->graph = graph;
+    this->rolling = rolling;
+    this->pos = &pos;
+    this->nframes = nframes;
+    this->time = time;
+    graph->prepare();
+    finished.store(0, std::memory_order_relaxed);
+    for(uint16_t i = 0; i < workerCount; i++) {
+        sem_post(&workers[i].start);
+    }
+    graph->execute(0, rolling, pos, nframes, time);
+    // join: no worker may touch the graph after this period
+    while(finished.load(std::memory_order_acquire) < workerCount) {
+        sched_yield();
+    }
+    // take over what the workers handed off while running
+    ObjectCollector::scriptCollector().gather(workerCount);
+    MethodQueue::instance().gather(workerCount);
+}
+
+/**
+ * Worker thread main loop.
+ */
+void WorkerPool::work(ProcessWorker *worker)
+{
+    WorkerIndex::set(worker->index);
+    while(true) {
+        sem_wait(&worker->start);
+        if(cancelled.load()) {
+            return;
+        }
+        RtSafety::enterProcess();
+        graph->execute(worker->index, rolling, *pos, nframes, time);
+        RtSafety::leaveProcess();
+        finished.fetch_add(1, std::memory_order_release);
+    }
+}
+
+}
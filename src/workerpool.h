@@ -0,0 +1,63 @@
+/*
+ * This file is part of Bipscript.
+ *
+ * Bipscript is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bipscript is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bipscript.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include "processgraph.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+
+namespace bipscript {
+
+class WorkerPool;
+
+struct ProcessWorker
+{
+    WorkerPool *pool;
+    uint16_t index;
+    pthread_t thread;
+    sem_t start;
+};
+
+/**
+ * Realtime threads that help the process thread run independent branches of a ProcessGraph.
+ */
+class WorkerPool
+{
+    uint16_t workerCount;
+    ProcessWorker *workers;
+    std::atomic<bool> cancelled;
+    std::atomic<uint16_t> finished;
+    // current period
+    ProcessGraph *graph;
+    bool rolling;
+    jack_position_t *pos;
+    jack_nframes_t nframes;
+    jack_nframes_t time;
+public:
+    WorkerPool() : workerCount(0), workers(0), cancelled(false), finished(0) {}
+    uint16_t size() { return workerCount; }
+    void start(uint16_t count, int priority);
+    void stop();
+    void run(ProcessGraph *graph, bool rolling, jack_position_t &pos, jack_nframes_t nframes, jack_nframes_t time);
+    void work(ProcessWorker *worker);
+};
+
+}
+
+#endif // WORKERPOOL_H